@@ -11,15 +11,17 @@
 #include <cclib/content/contentmanager.h>
 #include <cclib/fx/shader.h>
 #include <cclib/fx/texture.h>
+#include <cclib/fx/texturestreamer.h>
+#include <cclib/fx/uniformbuffer.h>
 
 #include <gl/glew.h>
 #include <gl/glfw3.h>
 
 int main(int argc, char* argv[ ]) {
   try {
-    auto cm = content::ContentManager(argv[0]);
-
+    // Declared after the context, so that cached content is released before it.
     auto context = std::make_shared<fx::Context>( );
+    content::ContentManager cm(argv[0]);
     auto shader = cm.LoadContent<fx::Shader>("shaders/sprite");
     auto texture = cm.LoadContent<fx::Texture>("textures/ball");
 
@@ -29,6 +31,12 @@ int main(int argc, char* argv[ ]) {
     auto matrix = math::mat_ortho(0, 640, 0, 480);
     shader->Uniform("MVP", matrix);
 
+    fx::FrameUniforms frame;
+    frame.View = math::mat_identity<4, 4>( );
+    frame.Projection = matrix;
+    frame.ViewProjection = matrix;
+    auto last = (float) glfwGetTime( );
+
     auto v4 = math::vec4(1, 2, 3, 4);
     auto& z = v4.xyz( );
     printf("Something complex");
@@ -36,18 +44,31 @@ int main(int argc, char* argv[ ]) {
 
     do {
       context->Begin( );
-      glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
-      glClear(GL_COLOR_BUFFER_BIT);
-      shader->Apply( );
 
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      auto now = (float) glfwGetTime( );
+      frame.Time = math::vec4(now, now - last, 0.0f, 0.0f);
+      last = now;
+
+      // Everything touching GL goes through Submit, so the loop also works with a
+      // render thread.
+      context->Submit([&cm, frame, matrix, shader, sb, y]( ) {
+        cm.Update( );
+        fx::TextureStreamer::Shared( )->Update( );
+        fx::FrameUniformBuffer::Shared( )->Update(frame);
+
+        glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        shader->Apply( );
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-      sb->Begin(math::mat_identity<4, 4>( ));
+        sb->Begin(matrix);
 
-      sb->Draw((float)y, (float)y, 0.0f, 100.0f, 100.0f);
+        sb->Draw((float)y, (float)y, 0.0f, 100.0f, 100.0f);
 
-      sb->End( );
+        sb->End( );
+      });
 
       y = (y + 1) % 400;
 
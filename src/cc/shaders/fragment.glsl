@@ -1,6 +1,7 @@
 #version 330 core
 
 in vec2 UV;
+in vec4 Color;
 out vec4 color;
 uniform sampler2D myTextureSampler;
 
@@ -8,5 +9,5 @@ void main()
 {
 	vec2 uv = UV;
 	uv.y = 1 - uv.y;
-	color = texture(myTextureSampler, uv).rgba;
-}
+	color = texture(myTextureSampler, uv).rgba * Color;
+}
\ No newline at end of file
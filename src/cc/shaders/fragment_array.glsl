@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 UV;
+in vec4 Color;
+in float Layer;
+out vec4 color;
+uniform sampler2DArray myTextureSampler;
+
+void main()
+{
+	vec2 uv = UV;
+	uv.y = 1 - uv.y;
+	color = texture(myTextureSampler, vec3(uv, Layer)).rgba * Color;
+}
\ No newline at end of file
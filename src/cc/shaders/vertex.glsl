@@ -3,8 +3,10 @@
 // Input vertex data, different for all executions of this shader.
 layout(location = 0) in vec3 vertexPosition_modelspace;
 layout(location = 1) in vec2 vertexUV;
+layout(location = 2) in vec4 vertexColor;
 
 out vec2 UV;
+out vec4 Color;
 
 uniform mat4 MVP;
 
@@ -13,5 +15,6 @@ void main(){
 	vec4 v = vec4(vertexPosition_modelspace, 1.0);
 	gl_Position = MVP * v;
 	UV = vertexUV;
+	Color = vertexColor;
 
 }
\ No newline at end of file
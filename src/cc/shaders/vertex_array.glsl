@@ -0,0 +1,23 @@
+#version 330 core
+
+// Input vertex data, different for all executions of this shader.
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 1) in vec2 vertexUV;
+layout(location = 2) in vec4 vertexColor;
+layout(location = 3) in float vertexLayer;
+
+out vec2 UV;
+out vec4 Color;
+out float Layer;
+
+uniform mat4 MVP;
+
+void main(){
+
+	vec4 v = vec4(vertexPosition_modelspace, 1.0);
+	gl_Position = MVP * v;
+	UV = vertexUV;
+	Color = vertexColor;
+	Layer = vertexLayer;
+
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 330 core
+
+// Corner of the shared unit quad, different for all executions of this shader.
+layout(location = 0) in vec2 quadCorner;
+
+// Per-instance sprite data.
+layout(location = 1) in vec3 instancePosition;
+layout(location = 2) in vec2 instanceSize;
+layout(location = 3) in float instanceRotation;
+layout(location = 4) in vec4 instanceUV;
+layout(location = 5) in vec4 instanceColor;
+
+out vec2 UV;
+out vec4 Color;
+
+uniform mat4 MVP;
+
+void main(){
+
+	vec2 halfSize = instanceSize * 0.5;
+	vec2 local = quadCorner * instanceSize - halfSize;
+	float s = sin(instanceRotation);
+	float c = cos(instanceRotation);
+	vec2 rotated = vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+	vec4 v = vec4(instancePosition.xy + halfSize + rotated, instancePosition.z, 1.0);
+	gl_Position = MVP * v;
+	UV = mix(instanceUV.xy, instanceUV.zw, quadCorner);
+	Color = instanceColor;
+
+}
\ No newline at end of file
@@ -1,12 +1,16 @@
 #include "stdafx.h"
 #include "contentmanager.h"
 
+#include <iterator>
+
+#include "../logging.h"
+
 using namespace std;
 using namespace std::tr2::sys;
 
 namespace content {
 
-  LoadOperation::LoadOperation(content::ContentManager& contentManager, const string path, const string fullPath, const std::shared_ptr<std::istream> data) :
+  LoadOperation::LoadOperation(content::ContentManager& contentManager, const string path, const string fullPath, const std::shared_ptr<ContentView> data) :
     ContentManager(contentManager),
     Path(path),
     FullPath(fullPath),
@@ -40,13 +44,224 @@ namespace content {
     return finalPath;
   }
 
-  ContentManager::ContentManager(const string basePath, bool includesExeName) :
-    _basePath(ResolveName(basePath, includesExeName)) {
+  ContentManager::ContentManager(const string basePath, bool includesExeName, uint32_t workers) :
+    _basePath(ResolveName(basePath, includesExeName)),
+    _budget(0),
+    _resident(0),
+    _stopping(false) {
 
+    for (uint32_t i = 0; i < workers; ++i) {
+      _workers.push_back(std::thread(&ContentManager::Work, this));
+    }
   }
 
   ContentManager::~ContentManager( ) {
+    {
+      std::lock_guard<std::mutex> lock(_queueLock);
+      _stopping = true;
+    }
+    _queueSignal.notify_all( );
+    for (auto it = _workers.begin( ); it != _workers.end( ); ++it) {
+      it->join( );
+    }
+
+    // Nothing will run the remaining work, so fail its futures with a clear error.
+    for (auto it = _jobs.begin( ); it != _jobs.end( ); ++it) {
+      it->Cancel( );
+    }
+    for (auto it = _completions.begin( ); it != _completions.end( ); ++it) {
+      it->Cancel( );
+    }
+  }
+
+  void ContentManager::Mount(const string packPath) {
+    auto pack = make_shared<ContentPack>((_basePath / std::tr2::sys::path(packPath)).string( ));
+
+    std::lock_guard<std::mutex> lock(_contentLock);
+    _packs.push_back(pack);
+  }
+
+  void ContentManager::Resolve(const string path, string& fullPath, string& relativePath) {
+    auto finalPath = _basePath;
+    auto addPath = std::tr2::sys::path(path);
+    auto fixedPath = std::tr2::sys::path( );
+
+    for (auto it = addPath.begin( ); it != addPath.end( ); ++it) {
+      if (*it == "..") {
+        if (fixedPath.empty( ))
+          throw EngineException("Can not navigate out of content folder: " + path, ErrorCode::CONTENT_INVALID_PATH);
+        finalPath = finalPath.parent_path( );
+        fixedPath = fixedPath.parent_path( );
+      } else if (*it == ".") {
+
+      } else {
+        finalPath /= *it;
+        fixedPath /= *it;
+      }
+    }
+    fullPath = finalPath.string( );
+    relativePath = fixedPath.string( );
+  }
+
+  shared_ptr<ContentView> ContentManager::Open(const string fullPath, const string relativePath) {
+    std::vector<std::shared_ptr<ContentPack>> packs;
+    {
+      std::lock_guard<std::mutex> lock(_contentLock);
+      packs = _packs;
+    }
+
+    for (auto it = packs.rbegin( ); it != packs.rend( ); ++it) {
+      auto view = (*it)->Find(relativePath);
+      if (view) return view;
+    }
+
+    if (!std::tr2::sys::exists(std::tr2::sys::path(fullPath)))
+      throw EngineException("Unable to load content from file: " + relativePath, ErrorCode::CONTENT_NOT_FOUND);
+
+    auto file = make_shared<MappedFile>(fullPath);
+    return make_shared<ContentView>(file, 0, file->Size( ));
+  }
+
+  const string ContentManager::Combine(const string referencePath, const string relativePath) {
+    auto finalPath = std::tr2::sys::path(referencePath);
+    finalPath.remove_filename( );
+
+    auto relative = std::tr2::sys::path(relativePath);
+    for (auto it = relative.begin( ); it != relative.end( ); ++it) {
+      if (*it == "..") {
+        if (finalPath.empty( ))
+          throw EngineException("Can not navigate out of content folder: " + relativePath, ErrorCode::CONTENT_INVALID_PATH);
+        finalPath = finalPath.parent_path( );
+      } else if (*it == ".") {
+
+      } else {
+        finalPath /= *it;
+      }
+    }
 
+    return finalPath.string( );
+  }
+
+  void ContentManager::Update(std::chrono::microseconds budget) {
+    // Content released by the game since the last frame may now be evictable.
+    Trim( );
+
+    const auto start = std::chrono::high_resolution_clock::now( );
+    do {
+      std::function<void( )> completion;
+      {
+        std::lock_guard<std::mutex> lock(_queueLock);
+        if (_completions.empty( )) return;
+        completion = _completions.front( ).Run;
+        _completions.pop_front( );
+      }
+      completion( );
+    } while (std::chrono::high_resolution_clock::now( ) - start < budget);
+  }
+
+  const size_t ContentManager::Pending( ) {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _jobs.size( ) + _completions.size( );
+  }
+
+  void ContentManager::Enqueue(const std::function<void( )>& job, const std::function<void( )>& cancel) {
+    // Without workers the decoding happens right away on the calling thread.
+    if (_workers.empty( )) {
+      job( );
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_queueLock);
+      QueuedWork work = { job, cancel };
+      _jobs.push_back(work);
+    }
+    _queueSignal.notify_one( );
+  }
+
+  void ContentManager::Complete(const std::function<void( )>& completion, const std::function<void( )>& cancel) {
+    QueuedWork work = { completion, cancel };
+    std::lock_guard<std::mutex> lock(_queueLock);
+    _completions.push_back(work);
+  }
+
+  void ContentManager::Work( ) {
+    for (;;) {
+      std::function<void( )> job;
+      {
+        std::unique_lock<std::mutex> lock(_queueLock);
+        _queueSignal.wait(lock, [this]( ) { return _stopping || !_jobs.empty( ); });
+        if (_stopping) return;
+        job = _jobs.front( ).Run;
+        _jobs.pop_front( );
+      }
+      job( );
+    }
+  }
+
+  void ContentManager::Budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(_contentLock);
+    _budget = bytes;
+  }
+
+  const size_t ContentManager::Resident( ) {
+    std::lock_guard<std::mutex> lock(_contentLock);
+    return _resident;
+  }
+
+  std::shared_ptr<void> ContentManager::Cached(const ContentKey& key) {
+    std::lock_guard<std::mutex> lock(_contentLock);
+    auto value = _loadedContent.find(key);
+    if (value == _loadedContent.end( )) return nullptr;
+
+    _recentlyUsed.splice(_recentlyUsed.begin( ), _recentlyUsed, value->second.Use);
+    return value->second.Content;
+  }
+
+  void ContentManager::Cache(const ContentKey& key, const std::shared_ptr<void>& content, const std::function<size_t( )>& measure) {
+    auto size = measure( );
+    {
+      std::lock_guard<std::mutex> lock(_contentLock);
+      _recentlyUsed.push_front(key);
+      CachedContent entry = { content, measure, size, _recentlyUsed.begin( ) };
+      _loadedContent[key] = entry;
+      _resident += size;
+    }
+    Trim( );
+  }
+
+  void ContentManager::Trim( ) {
+    // Evicted content is released outside the lock; its destructor deletes GL objects.
+    std::vector<std::shared_ptr<void>> evicted;
+    {
+      std::lock_guard<std::mutex> lock(_contentLock);
+
+      // Trim runs on the GL thread, the only one that changes content sizes.
+      _resident = 0;
+      for (auto it = _loadedContent.begin( ); it != _loadedContent.end( ); ++it) {
+        it->second.Size = it->second.Measure( );
+        _resident += it->second.Size;
+      }
+      if (_budget == 0) return;
+
+      for (auto it = _recentlyUsed.rbegin( ); it != _recentlyUsed.rend( ) && _resident > _budget; ) {
+        auto value = _loadedContent.find(*it);
+        auto& entry = value->second;
+        if (entry.Size == 0 || entry.Content.use_count( ) > 1) {
+          ++it;
+          continue;
+        }
+
+        _resident -= entry.Size;
+        evicted.push_back(entry.Content);
+        it = std::list<ContentKey>::reverse_iterator(_recentlyUsed.erase(std::next(it).base( )));
+        _loadedContent.erase(value);
+      }
+    }
+
+    if (!evicted.empty( )) {
+      LOG(DEBUG) << L"Evicted " << evicted.size( ) << L" content items over budget.";
+    }
   }
 
 }
\ No newline at end of file
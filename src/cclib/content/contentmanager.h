@@ -1,15 +1,24 @@
 #pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <filesystem>
 #include <functional>
-#include <fstream>
-#include <istream>
+#include <future>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <typeindex>
+#include <vector>
 
 #include "../engineexception.h"
+#include "contentpack.h"
+#include "mappedfile.h"
 
 namespace std {
   template<> struct hash < std::tuple<std::type_index, std::string> > {
@@ -29,13 +38,13 @@ namespace content {
     LoadOperation(const LoadOperation&) = default;
     LoadOperation& operator=(const LoadOperation&) = delete;
 
-    LoadOperation(ContentManager& contentManager, const std::string path, const std::string fullPath, const std::shared_ptr<std::istream> data);
+    LoadOperation(ContentManager& contentManager, const std::string path, const std::string fullPath, const std::shared_ptr<ContentView> data);
     ~LoadOperation( );
 
     ContentManager& ContentManager;
     const std::string Path;
     const std::string FullPath;
-    const std::shared_ptr<std::istream> Data;
+    const std::shared_ptr<ContentView> Data;
   };
 
   class ContentManager {
@@ -43,76 +52,155 @@ namespace content {
     ContentManager(const ContentManager&) = default;
     ContentManager& operator=(const ContentManager&) = delete;
 
-    ContentManager(const std::string basePath, bool includesExeName = true);
+    ContentManager(const std::string basePath, bool includesExeName = true, uint32_t workers = 2);
     ~ContentManager( );
 
+    // Content is looked up in mounted packs, most recently mounted first, before
+    // falling back to loose files. The path is relative to the content folder.
+    void Mount(const std::string packPath);
+
     template <typename T> std::shared_ptr<T> LoadContent(const std::string referencePath, const std::string relativePath);
     template <typename T> std::shared_ptr<T> LoadContent(const std::string path);
 
+    // Reads and decodes the content on a worker thread. The GL objects are created
+    // by Update on the calling thread, so the future is only ready after an Update.
+    // Loads still waiting when the manager is destroyed fail with CONTENT_SHUT_DOWN.
+    template <typename T> std::shared_future<std::shared_ptr<T>> LoadContentAsync(const std::string referencePath, const std::string relativePath);
+    template <typename T> std::shared_future<std::shared_ptr<T>> LoadContentAsync(const std::string path);
+
+    // Finishes queued asynchronous loads on the GL thread until the budget is spent.
+    // At least one load is finished per call if any are waiting.
+    void Update(std::chrono::microseconds budget = std::chrono::microseconds(2000));
+    const size_t Pending( );
+
+    // Caps the GPU memory held by cached content. Once the budget is exceeded, content
+    // nothing else references is evicted least recently used first and is reloaded
+    // the next time it is requested. Sizes are measured again on every Update, so
+    // streamed textures count at the size they have grown to. Zero, the default,
+    // means no limit.
+    void Budget(size_t bytes);
+    const size_t Resident( );
+
     private:
+    typedef std::tuple<std::type_index, std::string> ContentKey;
+
+    struct CachedContent {
+      std::shared_ptr<void> Content;
+      // Sizes can change after loading, as when a texture streams in more levels.
+      std::function<size_t( )> Measure;
+      size_t Size;
+      std::list<ContentKey>::iterator Use;
+    };
+
     const std::tr2::sys::path _basePath;
-    std::unordered_map<std::tuple<std::type_index, std::string>, std::shared_ptr<void>> _loadedContent;
 
-    template <typename T> std::shared_ptr<T> LoadContent(const LoadOperation& operation);
+    std::mutex _contentLock;
+    std::unordered_map<ContentKey, CachedContent> _loadedContent;
+    std::list<ContentKey> _recentlyUsed;
+    size_t _budget, _resident;
+    std::vector<std::shared_ptr<ContentPack>> _packs;
+
+    std::mutex _queueLock;
+    std::condition_variable _queueSignal;
+    // Cancel runs instead of Run for work still queued when the manager is destroyed.
+    struct QueuedWork {
+      std::function<void( )> Run;
+      std::function<void( )> Cancel;
+    };
+
+    std::deque<QueuedWork> _jobs;
+    std::deque<QueuedWork> _completions;
+    std::vector<std::thread> _workers;
+    bool _stopping;
+
+    const std::string Combine(const std::string referencePath, const std::string relativePath);
+    void Resolve(const std::string path, std::string& fullPath, std::string& relativePath);
+    std::shared_ptr<ContentView> Open(const std::string fullPath, const std::string relativePath);
+    void Enqueue(const std::function<void( )>& job, const std::function<void( )>& cancel);
+    void Complete(const std::function<void( )>& completion, const std::function<void( )>& cancel);
+    void Work( );
+
+    std::shared_ptr<void> Cached(const ContentKey& key);
+    void Cache(const ContentKey& key, const std::shared_ptr<void>& content, const std::function<size_t( )>& measure);
+    void Trim( );
+
+    // Runs on any thread and returns the GL-thread half of the load.
+    template <typename T> std::function<std::shared_ptr<T>( )> Prepare(const std::string referencePath, const std::string relativePath);
+    template <typename T> std::function<std::shared_ptr<T>( )> Prepare(const std::string path);
+
+    // Implemented per content type: the returned function must only touch GL.
+    template <typename T> std::function<std::shared_ptr<T>( )> PrepareContent(const LoadOperation& operation);
     template <typename T> const std::string ContentExtension( );
+    template <typename T> const size_t ContentSize(T& content);
   };
 
   template <typename T> std::shared_ptr<T> ContentManager::LoadContent(const std::string referencePath, const std::string relativePath) {
-    auto finalPath = std::tr2::sys::path(referencePath);
-    finalPath.remove_filename( );
-
-    auto relative = std::tr2::sys::path(relativePath);
-    for (auto it = relative.begin( ); it != relative.end( ); ++it) {
-      if (*it == "..") {
-        if (finalPath.empty( ))
-          throw EngineException("Can not navigate out of content folder: " + relativePath, ErrorCode::CONTENT_INVALID_PATH);
-        finalPath = finalPath.parent_path( );
-      } else if (*it == ".") {
-
-      } else {
-        finalPath /= *it;
-      }
-    }
-
-    return LoadContent<T>(finalPath.string( ));
+    return LoadContent<T>(Combine(referencePath, relativePath));
   }
 
   template <typename T> std::shared_ptr<T> ContentManager::LoadContent(const std::string path) {
-    auto finalPath = _basePath;
-    auto addPath = std::tr2::sys::path(path + ContentExtension<T>( ));
-    auto fixedPath = std::tr2::sys::path( );
-
-    for (auto it = addPath.begin( ); it != addPath.end( ); ++it) {
-      if (*it == "..") {
-        if (fixedPath.empty( ))
-          throw EngineException("Can not navigate out of content folder: " + path, ErrorCode::CONTENT_INVALID_PATH);
-        finalPath = finalPath.parent_path( );
-        fixedPath = fixedPath.parent_path( );
-      } else if (*it == ".") {
-
-      } else {
-        finalPath /= *it;
-        fixedPath /= *it;
+    return Prepare<T>(path)( );
+  }
+
+  template <typename T> std::shared_future<std::shared_ptr<T>> ContentManager::LoadContentAsync(const std::string referencePath, const std::string relativePath) {
+    return LoadContentAsync<T>(Combine(referencePath, relativePath));
+  }
+
+  template <typename T> std::shared_future<std::shared_ptr<T>> ContentManager::LoadContentAsync(const std::string path) {
+    auto promise = std::make_shared<std::promise<std::shared_ptr<T>>>( );
+    auto future = promise->get_future( ).share( );
+
+    auto cancel = [promise, path]( ) {
+      promise->set_exception(std::make_exception_ptr(
+        EngineException("The content manager shut down before loading: " + path, ErrorCode::CONTENT_SHUT_DOWN)));
+    };
+
+    Enqueue([this, path, promise, cancel]( ) {
+      try {
+        auto create = Prepare<T>(path);
+        Complete([promise, create]( ) {
+          try {
+            promise->set_value(create( ));
+          } catch (...) {
+            promise->set_exception(std::current_exception( ));
+          }
+        }, cancel);
+      } catch (...) {
+        promise->set_exception(std::current_exception( ));
       }
-    }
-    auto fullPath = finalPath.string( );
-    auto relativePath = fixedPath.string( );
+    }, cancel);
 
-    auto key = std::tuple<std::type_index, std::string>(std::type_index(typeid(T)), fullPath);
-    auto value = _loadedContent.find(key);
+    return future;
+  }
+
+  template <typename T> std::function<std::shared_ptr<T>( )> ContentManager::Prepare(const std::string referencePath, const std::string relativePath) {
+    return Prepare<T>(Combine(referencePath, relativePath));
+  }
 
-    if (value == _loadedContent.end( )) {
-      auto stream = std::make_shared<std::ifstream>(fullPath, std::ios::in);
-      if (!stream || !stream->is_open( )) {
-        throw EngineException("Unable to load content from file: " + relativePath, ErrorCode::CONTENT_NOT_FOUND);
+  template <typename T> std::function<std::shared_ptr<T>( )> ContentManager::Prepare(const std::string path) {
+    std::string fullPath, relativePath;
+    Resolve(path + ContentExtension<T>( ), fullPath, relativePath);
+
+    auto key = ContentKey(std::type_index(typeid(T)), fullPath);
+    auto cached = std::static_pointer_cast<T>(Cached(key));
+    if (cached) {
+      return [cached]( ) { return cached; };
+    }
+
+    auto operation = LoadOperation(*this, relativePath, fullPath, Open(fullPath, relativePath));
+    auto create = PrepareContent<T>(operation);
+
+    // Another load of the same content may have finished while this one was decoding.
+    return [this, key, create]( ) -> std::shared_ptr<T> {
+      auto content = std::static_pointer_cast<T>(Cached(key));
+      if (!content) {
+        content = create( );
+        // The entry keeps the content alive for as long as it can be measured.
+        auto raw = content.get( );
+        Cache(key, content, [this, raw]( ) { return ContentSize<T>(*raw); });
       }
-      auto operation = LoadOperation(*this, relativePath, fullPath, stream);
-      auto content = LoadContent<T>(operation);
-      _loadedContent[key] = content;
       return content;
-    } else {
-      return std::static_pointer_cast<T>(value->second);
-    }
+    };
   }
 
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "stdafx.h"
+#include "contentpack.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "../engineexception.h"
+
+using namespace std;
+
+namespace content {
+
+  ContentPack::ContentPack(const string path) :
+    _path(path),
+    _file(make_shared<MappedFile>(path)),
+    _entries(nullptr),
+    _count(0) {
+
+    auto data = _file->Data( );
+    auto size = _file->Size( );
+
+    if (size < sizeof(PackHeader))
+      throw EngineException("Content pack is truncated: " + path, ErrorCode::CONTENT_INVALID_DATA);
+
+    auto header = reinterpret_cast<const PackHeader*>(data);
+    if (memcmp(header->Magic, PackMagic, sizeof(PackMagic)) != 0 || header->Version != PackVersion)
+      throw EngineException("Not a supported content pack: " + path, ErrorCode::CONTENT_INVALID_DATA);
+
+    if ((size - sizeof(PackHeader)) / sizeof(PackEntry) < header->Count)
+      throw EngineException("Content pack is truncated: " + path, ErrorCode::CONTENT_INVALID_DATA);
+
+    _entries = reinterpret_cast<const PackEntry*>(data + sizeof(PackHeader));
+    _count = header->Count;
+
+    for (uint32_t i = 0; i < _count; ++i) {
+      auto& entry = _entries[i];
+      if ((uint64_t) entry.NameOffset + entry.NameSize > size || entry.Offset > size || entry.Size > size - entry.Offset)
+        throw EngineException("Content pack entry is out of range: " + path, ErrorCode::CONTENT_INVALID_DATA);
+      if (i > 0 && _entries[i - 1].Hash > entry.Hash)
+        throw EngineException("Content pack entries are not sorted: " + path, ErrorCode::CONTENT_INVALID_DATA);
+    }
+  }
+
+  ContentPack::~ContentPack( ) {
+
+  }
+
+  const uint32_t ContentPack::Count( ) {
+    return _count;
+  }
+
+  shared_ptr<ContentView> ContentPack::Find(const string name) {
+    auto normalized = Normalize(name);
+    auto hash = Hash(normalized);
+
+    auto entry = lower_bound(_entries, _entries + _count, hash, [ ](const PackEntry& e, uint64_t h) { return e.Hash < h; });
+    for (; entry != _entries + _count && entry->Hash == hash; ++entry) {
+      // Hashes may collide, so the name decides.
+      if (entry->NameSize == normalized.size( ) &&
+        memcmp(_file->Data( ) + entry->NameOffset, normalized.data( ), normalized.size( )) == 0) {
+        return make_shared<ContentView>(_file, (size_t) entry->Offset, (size_t) entry->Size);
+      }
+    }
+    return nullptr;
+  }
+
+  const string ContentPack::Normalize(const string name) {
+    auto normalized = name;
+    replace(normalized.begin( ), normalized.end( ), '\\', '/');
+    return normalized;
+  }
+
+  const uint64_t ContentPack::Hash(const string name) {
+    // 64-bit FNV-1a.
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (auto it = name.begin( ); it != name.end( ); ++it) {
+      hash ^= (uint8_t) *it;
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+}
\ No newline at end of file
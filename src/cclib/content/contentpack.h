@@ -0,0 +1,57 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include "mappedfile.h"
+
+namespace content {
+
+  // Pack layout: a PackHeader, Count PackEntry records sorted by Hash, the entry
+  // names, then the entry data. Offsets are from the start of the file and the
+  // data of each entry starts on a PackAlignment boundary.
+  struct PackHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t Count;
+    uint32_t Reserved;
+  };
+
+  struct PackEntry {
+    uint64_t Hash;
+    uint64_t Offset;
+    uint64_t Size;
+    uint32_t NameOffset;
+    uint32_t NameSize;
+  };
+
+  static const char PackMagic[4] = { 'C', 'C', 'P', 'K' };
+  static const uint32_t PackVersion = 1;
+  static const uint32_t PackAlignment = 16;
+
+  // A mounted pack file. Entries are named by their path relative to the content
+  // folder, including the extension, with '/' separators.
+  class ContentPack {
+    public:
+    ContentPack(const ContentPack&) = default;
+    ContentPack& operator=(const ContentPack&) = delete;
+
+    ContentPack(const std::string path);
+    ~ContentPack( );
+
+    const uint32_t Count( );
+
+    // Returns null if the pack has no entry with this name.
+    std::shared_ptr<ContentView> Find(const std::string name);
+
+    static const std::string Normalize(const std::string name);
+    static const uint64_t Hash(const std::string name);
+
+    private:
+    const std::string _path;
+    const std::shared_ptr<MappedFile> _file;
+    const PackEntry* _entries;
+    uint32_t _count;
+  };
+
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "stdafx.h"
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../engineexception.h"
+
+using namespace std;
+
+namespace content {
+
+#ifdef _WIN32
+
+  MappedFile::MappedFile(const string path) :
+    _data(nullptr),
+    _size(0),
+    _file(INVALID_HANDLE_VALUE),
+    _mapping(nullptr) {
+
+    _file = CreateFileA(path.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+      throw EngineException("Unable to load content from file: " + path, ErrorCode::CONTENT_NOT_FOUND);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_file, &size)) {
+      CloseHandle(_file);
+      throw EngineException("Unable to load content from file: " + path, ErrorCode::CONTENT_NOT_FOUND);
+    }
+    _size = (size_t) size.QuadPart;
+
+    // Empty files can not be mapped; they are simply views of nothing.
+    if (_size == 0) return;
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping) {
+      _data = reinterpret_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!_data) {
+      if (_mapping) CloseHandle(_mapping);
+      CloseHandle(_file);
+      throw EngineException("Unable to map content file: " + path, ErrorCode::CONTENT_NOT_FOUND);
+    }
+  }
+
+  MappedFile::~MappedFile( ) {
+    if (_data) UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+  }
+
+#else
+
+  MappedFile::MappedFile(const string path) :
+    _data(nullptr),
+    _size(0),
+    _file(-1) {
+
+    _file = open(path.c_str( ), O_RDONLY);
+    if (_file < 0)
+      throw EngineException("Unable to load content from file: " + path, ErrorCode::CONTENT_NOT_FOUND);
+
+    struct stat info;
+    if (fstat(_file, &info) != 0) {
+      close(_file);
+      throw EngineException("Unable to load content from file: " + path, ErrorCode::CONTENT_NOT_FOUND);
+    }
+    _size = (size_t) info.st_size;
+
+    // Empty files can not be mapped; they are simply views of nothing.
+    if (_size == 0) return;
+
+    auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+    if (data == MAP_FAILED) {
+      close(_file);
+      throw EngineException("Unable to map content file: " + path, ErrorCode::CONTENT_NOT_FOUND);
+    }
+    _data = reinterpret_cast<const uint8_t*>(data);
+  }
+
+  MappedFile::~MappedFile( ) {
+    if (_data) munmap(const_cast<uint8_t*>(_data), _size);
+    if (_file >= 0) close(_file);
+  }
+
+#endif
+
+  const uint8_t* MappedFile::Data( ) {
+    return _data;
+  }
+
+  const size_t MappedFile::Size( ) {
+    return _size;
+  }
+
+  ContentView::ContentView(const shared_ptr<MappedFile> file, const size_t offset, const size_t size) :
+    _file(file),
+    _data(file->Data( ) + offset),
+    _size(size) {
+
+  }
+
+  ContentView::~ContentView( ) {
+
+  }
+
+  const uint8_t* ContentView::Data( ) {
+    return _data;
+  }
+
+  const size_t ContentView::Size( ) {
+    return _size;
+  }
+
+}
\ No newline at end of file
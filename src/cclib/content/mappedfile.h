@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+namespace content {
+
+  // A whole file mapped read-only into memory.
+  class MappedFile {
+    public:
+    MappedFile(const MappedFile&) = default;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(const std::string path);
+    ~MappedFile( );
+
+    const uint8_t* Data( );
+    const size_t Size( );
+
+    private:
+    const uint8_t* _data;
+    size_t _size;
+#ifdef _WIN32
+    void* _file;
+    void* _mapping;
+#else
+    int _file;
+#endif
+  };
+
+  // A range of bytes in a mapped file, handed to content loaders without copying.
+  // The view keeps its file mapped for as long as it is held.
+  class ContentView {
+    public:
+    ContentView(const ContentView&) = default;
+    ContentView& operator=(const ContentView&) = delete;
+
+    ContentView(const std::shared_ptr<MappedFile> file, const size_t offset, const size_t size);
+    ~ContentView( );
+
+    const uint8_t* Data( );
+    const size_t Size( );
+
+    private:
+    const std::shared_ptr<MappedFile> _file;
+    const uint8_t* _data;
+    const size_t _size;
+  };
+
+}
\ No newline at end of file
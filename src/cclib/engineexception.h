@@ -14,13 +14,18 @@ enum class ErrorCode {
 
   FX_SHADER_COMPILE_FAILURE = FX_LOW + 0x1,
   FX_TEXTURE_LOAD_FAILURE = FX_LOW + 0x2,
+  FX_BUFFER_OVERFLOW = FX_LOW + 0x3,
+  FX_NO_CONTEXT = FX_LOW + 0x4,
+  FX_ATLAS_OVERFLOW = FX_LOW + 0x5,
+  FX_INVALID_SPRITE = FX_LOW + 0x6,
 
   CONTENT_LOW = 0xFF,
   CONTENT_HIGH = 0x1FD,
 
   CONTENT_NOT_FOUND = CONTENT_LOW + 0x1,
   CONTENT_INVALID_PATH = CONTENT_LOW + 0x2,
-  CONTENT_INVALID_DATA = CONTENT_LOW + 0x3
+  CONTENT_INVALID_DATA = CONTENT_LOW + 0x3,
+  CONTENT_SHUT_DOWN = CONTENT_LOW + 0x4
 };
 
 class EngineException : public std::exception {
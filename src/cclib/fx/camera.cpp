@@ -17,6 +17,18 @@ namespace fx {
   }
 
   mat4 Camera::Matrix( ) {
+    const auto pos = Origin( );
+    const auto ortho = mat_ortho(0.0f, _viewport.x( ), 0.0f, _viewport.y( ));
+    const auto trans = mat_translate<4>(vec3(-pos.x( ), -pos.y( ), 0));
+    return ortho * trans;
+  }
+
+  vec4 Camera::Bounds( ) {
+    const auto pos = Origin( );
+    return vec4(pos.x( ), pos.y( ), pos.x( ) + _viewport.x( ), pos.y( ) + _viewport.y( ));
+  }
+
+  vec2 Camera::Origin( ) {
     auto pos = _position;
 
     if (_extents.x( ) > 0 && _extents.y( ) > 0) {
@@ -30,9 +42,7 @@ namespace fx {
       pos = pos + half;
     }
 
-    const auto ortho = mat_ortho(0.0f, _viewport.x( ), 0.0f, _viewport.y( ));
-    const auto trans = mat_translate<4>(vec3(-pos.x( ), -pos.y( ), 0));
-    return ortho * trans;
+    return pos;
   }
 
 }
\ No newline at end of file
@@ -9,6 +9,8 @@ namespace fx {
     ~Camera( );
 
     math::mat4 Matrix( );
+    // The visible world rectangle as (left, bottom, right, top).
+    math::vec4 Bounds( );
     math::vec2& Position( );
     math::vec2& Viewport( );
     math::vec2& Extents( );
@@ -17,5 +19,7 @@ namespace fx {
     math::vec2 _position;
     math::vec2 _viewport;
     math::vec2 _extents;
+
+    math::vec2 Origin( );
   };
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include <string>
 
+#include "gpuprofiler.h"
 #include "../logging.h"
 
 #define WND reinterpret_cast<GLFWwindow*>(_native)
@@ -18,15 +19,26 @@ namespace fx {
   static int _glewInit;
   static int _lastErrorCode;
   static string _lastErrorString;
+  static Context* _current;
 
   void ErrorCallback(int errorCode, const char* message) {
     _lastErrorCode = errorCode;
     _lastErrorString = message;
   }
 
+  void Context::FramebufferSizeCallback(void* window, int width, int height) {
+    auto context = reinterpret_cast<Context*>(glfwGetWindowUserPointer(reinterpret_cast<GLFWwindow*>(window)));
+    context->_framebufferWidth = (uint32_t) width;
+    context->_framebufferHeight = (uint32_t) height;
+  }
+
   Context::Context(const ContextOptions& options, string title)
   : _options(options)
-  , _native(nullptr) {
+  , _native(nullptr)
+  , _framebufferWidth(0)
+  , _framebufferHeight(0)
+  , _framePending(false)
+  , _stopping(false) {
 
     if ((++_glfwInit) == 1) {
       glfwSetErrorCallback(&ErrorCallback);
@@ -68,6 +80,7 @@ namespace fx {
     }
 
     glfwMakeContextCurrent(WND);
+    _current = this;
 
     if ((++_glewInit) == 1) {
       glewExperimental = true;
@@ -78,9 +91,37 @@ namespace fx {
     }
 
     glfwSetInputMode(WND, GLFW_STICKY_KEYS, GL_TRUE);
+
+    int width, height;
+    glfwGetFramebufferSize(WND, &width, &height);
+    _framebufferWidth = (uint32_t) width;
+    _framebufferHeight = (uint32_t) height;
+    glfwSetWindowUserPointer(WND, this);
+    glfwSetFramebufferSizeCallback(WND, reinterpret_cast<GLFWframebuffersizefun>(&Context::FramebufferSizeCallback));
+
+    if (_options.RenderThread) {
+      // A context can only be current on one thread at a time.
+      glfwMakeContextCurrent(nullptr);
+      _renderThread = thread(&Context::Render, this);
+    }
   }
 
   Context::~Context( ) {
+    if (_renderThread.joinable( )) {
+      {
+        lock_guard<mutex> lock(_frameLock);
+        _stopping = true;
+      }
+      _frameSignal.notify_all( );
+      _renderThread.join( );
+      glfwMakeContextCurrent(WND);
+    }
+
+    // Shared resources own GL objects; release them while the context still exists.
+    _shared.clear( );
+    if (_current == this) {
+      _current = nullptr;
+    }
     if (_native) {
       glfwDestroyWindow(WND);
       _native = nullptr;
@@ -94,18 +135,129 @@ namespace fx {
   }
 
   void Context::Begin( ) {
-    glfwMakeContextCurrent(WND);
+    if (!_renderThread.joinable( )) glfwMakeContextCurrent(WND);
+    _current = this;
   }
 
   void Context::End( ) {
-    glfwSwapBuffers(WND);
+    if (!_renderThread.joinable( )) {
+      Shared<GpuProfiler>( )->Frame( );
+      glfwSwapBuffers(WND);
+      glfwPollEvents( );
+      return;
+    }
+
+    {
+      unique_lock<mutex> lock(_frameLock);
+      _frameSignal.wait(lock, [this]( ) { return !_framePending || _failure; });
+      if (_failure) {
+        auto failure = _failure;
+        _failure = nullptr;
+        _recording.clear( );
+        rethrow_exception(failure);
+      }
+      _pending.swap(_recording);
+      _recording.clear( );
+      _pendingReleases.swap(_releases);
+      _framePending = true;
+    }
+    _frameSignal.notify_all( );
+
+    // GLFW only delivers events on the thread that created the window.
     glfwPollEvents( );
   }
 
+  void Context::Submit(const function<void( )>& command) {
+    if (_renderThread.joinable( )) {
+      _recording.push_back(command);
+    } else {
+      command( );
+    }
+  }
+
+  const bool Context::Threaded( ) {
+    return _renderThread.joinable( );
+  }
+
+  void Context::Release(const function<void( )>& release) {
+    auto context = _current;
+    if (!context) return;
+    if (!context->_renderThread.joinable( ) || context->_renderThread.get_id( ) == this_thread::get_id( )) {
+      release( );
+      return;
+    }
+
+    lock_guard<mutex> lock(context->_frameLock);
+    context->_releases.push_back(release);
+  }
+
+  static void RunAll(vector<function<void( )>>& functions) {
+    for (auto it = functions.begin( ); it != functions.end( ); ++it) {
+      (*it)( );
+    }
+    functions.clear( );
+  }
+
+  void Context::Render( ) {
+    glfwMakeContextCurrent(WND);
+
+    // Swapped with the pending frame, so both lists keep their storage between frames.
+    vector<function<void( )>> frame, releases;
+    for (;;) {
+      {
+        unique_lock<mutex> lock(_frameLock);
+        _frameSignal.wait(lock, [this]( ) { return _framePending || _stopping; });
+        if (!_framePending) break;
+        frame.swap(_pending);
+        releases.swap(_pendingReleases);
+        _framePending = false;
+      }
+      _frameSignal.notify_all( );
+
+      try {
+        for (auto it = frame.begin( ); it != frame.end( ); ++it) {
+          (*it)( );
+        }
+        Shared<GpuProfiler>( )->Frame( );
+        glfwSwapBuffers(WND);
+      } catch (...) {
+        LOG(ERROR) << L"A render command failed; the frame was dropped.";
+        {
+          lock_guard<mutex> lock(_frameLock);
+          _failure = current_exception( );
+        }
+        _frameSignal.notify_all( );
+      }
+      frame.clear( );
+
+      // Objects released while the frame was recorded may still be used by it.
+      RunAll(releases);
+    }
+
+    {
+      lock_guard<mutex> lock(_frameLock);
+      releases.swap(_releases);
+    }
+    RunAll(releases);
+    glfwMakeContextCurrent(nullptr);
+  }
+
   bool Context::CloseRequested( ) {
     return glfwWindowShouldClose(WND) != 0;
   }
 
+  const uint32_t Context::FramebufferWidth( ) {
+    return _framebufferWidth;
+  }
+
+  const uint32_t Context::FramebufferHeight( ) {
+    return _framebufferHeight;
+  }
+
+  Context* Context::Current( ) {
+    return _current;
+  }
+
   EngineException Context::CreateGraphicsException(std::string prefix) {
     throw EngineException(prefix + _lastErrorString, (ErrorCode) _lastErrorCode);
   }
@@ -1,5 +1,15 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
 
 #include "contextoptions.h"
 #include "../engineexception.h"
@@ -17,13 +27,67 @@ namespace fx {
     void Begin( );
     void End( );
 
+    // With the RenderThread option the GL context belongs to a thread of its own, and
+    // anything touching GL, shared resources included, must be submitted as a command.
+    // Commands recorded between Begin and End form a frame, which the render thread
+    // draws and presents while the next one is recorded. End only waits when the
+    // render thread is still a whole frame behind, and rethrows anything a command
+    // threw. Without the option commands run immediately.
+    void Submit(const std::function<void( )>& command);
+    const bool Threaded( );
+
+    // Deletes GL objects on the thread that owns the context. With a render thread the
+    // last reference to a texture or buffer is usually dropped on the game thread, so
+    // destructors hand their deletes to this. Off the render thread they are held back
+    // until the render thread has drawn the frame being recorded; otherwise they run
+    // immediately. Without a context they are dropped, since the objects went with it.
+    static void Release(const std::function<void( )>& release);
+
     bool CloseRequested( );
 
+    // The framebuffer size in pixels, kept up to date from window events so that
+    // reading it does not query GL. Safe to call from any thread.
+    const uint32_t FramebufferWidth( );
+    const uint32_t FramebufferHeight( );
+
+    // Resources shared by everything drawing into this context, created on first use.
+    // Lookups may come from content workers, so they are locked; creating a resource
+    // that touches GL must still happen on the GL thread.
+    template<typename T> std::shared_ptr<T> Shared( );
+
+    static Context* Current( );
     static EngineException CreateGraphicsException(std::string prefix = "");
 
     private:
     const ContextOptions _options;
     void* _native;
+    std::atomic<uint32_t> _framebufferWidth, _framebufferHeight;
+    std::recursive_mutex _sharedLock;
+    std::unordered_map<std::type_index, std::shared_ptr<void>> _shared;
+
+    std::thread _renderThread;
+    std::mutex _frameLock;
+    std::condition_variable _frameSignal;
+    std::vector<std::function<void( )>> _recording, _pending;
+    std::vector<std::function<void( )>> _releases, _pendingReleases;
+    bool _framePending, _stopping;
+    std::exception_ptr _failure;
+
+    void Render( );
+    static void FramebufferSizeCallback(void* window, int width, int height);
   };
 
+  template<typename T> std::shared_ptr<T> Context::Shared( ) {
+    // Recursive, since a resource's constructor may look up another one.
+    std::lock_guard<std::recursive_mutex> lock(_sharedLock);
+    auto key = std::type_index(typeid(T));
+    auto value = _shared.find(key);
+    if (value == _shared.end( )) {
+      auto resource = std::make_shared<T>( );
+      _shared[key] = resource;
+      return resource;
+    }
+    return std::static_pointer_cast<T>(value->second);
+  }
+
 }
\ No newline at end of file
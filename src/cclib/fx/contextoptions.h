@@ -11,6 +11,8 @@ namespace fx {
 
     bool DoubleBuffer;
     bool Debug;
+    // Moves the GL context to a thread of its own; see Context::Submit.
+    bool RenderThread;
 
     bool Resizeable;
     bool Visible;
@@ -31,6 +33,7 @@ namespace fx {
       Samples = 0;
       DoubleBuffer = true;
       Debug = false;
+      RenderThread = false;
 
       Resizeable = false;
       Visible = true;
@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "dds.h"
+
+#include <string.h>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "../engineexception.h"
+#include "../logging.h"
+
+using namespace std;
+
+namespace fx {
+
+#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
+#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
+#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
+
+  DdsImage ReadDds(content::ContentView& data, const string path) {
+    const uint8_t* header = data.Data( ) + 4;
+
+    if (data.Size( ) < 128 || strncmp(reinterpret_cast<const char*>(data.Data( )), "DDS ", 4) != 0) {
+      LOG(ERROR) << L"Bad texture header " << path << L" .";
+      throw EngineException("Failed to load texture: " + path, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+    }
+
+    DdsImage image;
+    image.Height = *(const uint32_t*)&(header[8]);
+    image.Width = *(const uint32_t*)&(header[12]);
+    image.LinearSize = *(const uint32_t*)&(header[16]);
+    auto mipMapCount = *(const uint32_t*)&(header[24]);
+    auto fourCC = *(const uint32_t*)&(header[80]);
+
+    switch (fourCC)
+    {
+    case FOURCC_DXT1: image.Format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+    case FOURCC_DXT3: image.Format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+    case FOURCC_DXT5: image.Format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+    default:
+      LOG(ERROR) << L"Unsupported FOURCC: " << fourCC << ": " << path << L" .";
+      throw EngineException("Failed to load texture: " + path, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+    }
+
+    if (image.LinearSize > 104857600)
+    {
+      LOG(ERROR) << L"Texture too large " << path << L" .";
+      throw EngineException("Failed to load texture: " + path, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+    }
+
+    // Files without mipmaps may report a count of zero.
+    if (mipMapCount == 0) mipMapCount = 1;
+
+    uint32_t blockSize = (image.Format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+    uint32_t width = image.Width;
+    uint32_t height = image.Height;
+    size_t offset = 128;
+    for (uint32_t level = 0; level < mipMapCount && (width || height); ++level)
+    {
+      if (width == 0) width = 1;
+      if (height == 0) height = 1;
+
+      DdsLevel mip;
+      mip.Width = width;
+      mip.Height = height;
+      mip.Size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+      mip.Data = data.Data( ) + offset;
+      if (data.Size( ) - offset < mip.Size) {
+        LOG(ERROR) << L"Truncated texture " << path << L" .";
+        throw EngineException("Failed to load texture: " + path, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+      }
+      image.Levels.push_back(mip);
+
+      offset += mip.Size;
+      width /= 2;
+      height /= 2;
+    }
+
+    return image;
+  }
+
+  shared_ptr<vector<uint8_t>> LoadDdsLevels(DdsImage& image, uint32_t first, uint32_t last) {
+    size_t size = 0;
+    for (auto level = first; level < last; ++level) {
+      size += image.Levels[level].Size;
+    }
+
+    auto buffer = make_shared<vector<uint8_t>>(size);
+    size_t offset = 0;
+    for (auto level = first; level < last; ++level) {
+      auto& mip = image.Levels[level];
+      if (mip.Size > 0) memcpy(&(*buffer)[offset], mip.Data, mip.Size);
+      mip.Data = buffer->data( ) + offset;
+      offset += mip.Size;
+    }
+    return buffer;
+  }
+
+  size_t DdsSize(uint32_t format, uint32_t width, uint32_t height, uint32_t levels) {
+    size_t blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+    size_t size = 0;
+    for (uint32_t level = 0; level < levels; ++level) {
+      size += ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+      width = width > 1 ? width / 2 : 1;
+      height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+  }
+
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../content/mappedfile.h"
+
+namespace fx {
+
+  struct DdsLevel {
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Size;
+    const uint8_t* Data;
+  };
+
+  // A DXT-compressed DDS file. The level data points into the view it was read
+  // from, so the view must be kept alive for as long as the levels are used.
+  struct DdsImage {
+    uint32_t Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t LinearSize;
+    std::vector<DdsLevel> Levels;
+  };
+
+  // Throws FX_TEXTURE_LOAD_FAILURE if the data is not a supported DDS file.
+  DdsImage ReadDds(content::ContentView& data, const std::string path);
+
+  // Copies levels first to last - 1 into the returned buffer and points the image's
+  // levels at the copy. Loaders call it on a worker, so that reading the file happens
+  // there instead of when the GL thread uploads the levels.
+  std::shared_ptr<std::vector<uint8_t>> LoadDdsLevels(DdsImage& image, uint32_t first, uint32_t last);
+
+  // Bytes taken by a DXT-compressed mip chain.
+  size_t DdsSize(uint32_t format, uint32_t width, uint32_t height, uint32_t levels);
+
+}
\ No newline at end of file
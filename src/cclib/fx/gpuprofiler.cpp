@@ -0,0 +1,160 @@
+#include "stdafx.h"
+#include "gpuprofiler.h"
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+  template<typename T> static double Milliseconds(T duration) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count( );
+  }
+
+  static double Milliseconds(GLuint64 begin, GLuint64 end) {
+    return end > begin ? (end - begin) / 1000000.0 : 0.0;
+  }
+
+  GpuProfiler::GpuProfiler( )
+    : _enabled(false)
+    , _profiling(false)
+    , _frame(0) {
+    _report.Frame = 0;
+    _report.CpuMilliseconds = 0.0;
+    _report.GpuMilliseconds = 0.0;
+  }
+
+  GpuProfiler::~GpuProfiler( ) {
+    // Queries still in flight are given back before the names are deleted.
+    if (_profiling) {
+      _queries.push_back(_current.QueryBegin);
+      for (auto it = _current.Markers.begin( ); it != _current.Markers.end( ); ++it) {
+        _queries.push_back(it->QueryBegin);
+        if (it->QueryEnd != 0) _queries.push_back(it->QueryEnd);
+      }
+    }
+    for (auto frame = _pending.begin( ); frame != _pending.end( ); ++frame) {
+      _queries.push_back(frame->QueryBegin);
+      _queries.push_back(frame->QueryEnd);
+      for (auto it = frame->Markers.begin( ); it != frame->Markers.end( ); ++it) {
+        _queries.push_back(it->QueryBegin);
+        _queries.push_back(it->QueryEnd);
+      }
+    }
+    if (!_queries.empty( )) glDeleteQueries((GLsizei) _queries.size( ), &_queries[0]);
+  }
+
+  std::shared_ptr<GpuProfiler> GpuProfiler::Shared( ) {
+    auto context = Context::Current( );
+    if (!context) {
+      throw EngineException("GPU profiling requires a current context.", ErrorCode::FX_NO_CONTEXT);
+    }
+    return context->Shared<GpuProfiler>( );
+  }
+
+  void GpuProfiler::Enable(bool enabled) {
+    _enabled = enabled;
+  }
+
+  const bool GpuProfiler::Enabled( ) {
+    return _enabled;
+  }
+
+  bool GpuProfiler::Begin(const char* name) {
+    if (!_profiling) return false;
+
+    Marker marker;
+    marker.Name = name;
+    marker.Depth = (uint32_t) _open.size( );
+    marker.QueryBegin = Timestamp( );
+    marker.QueryEnd = 0;
+    marker.CpuBegin = Clock::now( );
+
+    _open.push_back(_current.Markers.size( ));
+    _current.Markers.push_back(marker);
+    return true;
+  }
+
+  void GpuProfiler::End( ) {
+    if (_open.empty( )) return;
+
+    auto& marker = _current.Markers[_open.back( )];
+    _open.pop_back( );
+    marker.CpuEnd = Clock::now( );
+    marker.QueryEnd = Timestamp( );
+  }
+
+  void GpuProfiler::Frame( ) {
+    if (_profiling) {
+      // Markers left open would have no end query.
+      while (!_open.empty( )) End( );
+
+      _current.CpuEnd = Clock::now( );
+      _current.QueryEnd = Timestamp( );
+      _pending.push_back(std::move(_current));
+      _profiling = false;
+    }
+
+    // Results arrive in submission order, so a frame's last query being available
+    // means the whole frame is.
+    while (!_pending.empty( )) {
+      auto& oldest = _pending.front( );
+      GLint available = GL_FALSE;
+      glGetQueryObjectiv(oldest.QueryEnd, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available && _pending.size( ) <= Latency) break;
+
+      Resolve(oldest);
+      _pending.pop_front( );
+    }
+
+    if (_enabled) {
+      _current.Number = ++_frame;
+      _current.Markers.clear( );
+      _current.QueryBegin = Timestamp( );
+      _current.CpuBegin = Clock::now( );
+      _profiling = true;
+    }
+  }
+
+  const GpuFrameReport& GpuProfiler::Report( ) {
+    return _report;
+  }
+
+  uint32_t GpuProfiler::Timestamp( ) {
+    GLuint query;
+    if (_queries.empty( )) {
+      glGenQueries(1, &query);
+    } else {
+      query = _queries.back( );
+      _queries.pop_back( );
+    }
+    glQueryCounter(query, GL_TIMESTAMP);
+    return query;
+  }
+
+  void GpuProfiler::Resolve(FrameRecord& frame) {
+    GLuint64 begin, end;
+    glGetQueryObjectui64v(frame.QueryBegin, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(frame.QueryEnd, GL_QUERY_RESULT, &end);
+    _queries.push_back(frame.QueryBegin);
+    _queries.push_back(frame.QueryEnd);
+
+    _report.Frame = frame.Number;
+    _report.CpuMilliseconds = Milliseconds(frame.CpuEnd - frame.CpuBegin);
+    _report.GpuMilliseconds = Milliseconds(begin, end);
+    _report.Timings.clear( );
+
+    for (auto it = frame.Markers.begin( ); it != frame.Markers.end( ); ++it) {
+      glGetQueryObjectui64v(it->QueryBegin, GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(it->QueryEnd, GL_QUERY_RESULT, &end);
+      _queries.push_back(it->QueryBegin);
+      _queries.push_back(it->QueryEnd);
+
+      GpuTiming timing = { it->Name, it->Depth, Milliseconds(it->CpuEnd - it->CpuBegin), Milliseconds(begin, end) };
+      _report.Timings.push_back(timing);
+    }
+  }
+
+}
\ No newline at end of file
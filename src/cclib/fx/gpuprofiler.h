@@ -0,0 +1,113 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace fx {
+
+  struct GpuTiming {
+    const char* Name;
+    // Nesting level; zero for markers opened outside any other.
+    uint32_t Depth;
+    double CpuMilliseconds;
+    double GpuMilliseconds;
+  };
+
+  struct GpuFrameReport {
+    uint64_t Frame;
+    double CpuMilliseconds;
+    double GpuMilliseconds;
+    // In the order the markers were opened.
+    std::vector<GpuTiming> Timings;
+  };
+
+  // Times named sections of a frame on both the CPU and the GPU. Each marker reads a
+  // GL_TIMESTAMP query at either end, so markers may nest. Results are only collected
+  // once the GPU has caught up, a few frames later, so that reading them never stalls.
+  // Disabled by default, in which case markers cost a branch. The context closes a
+  // profiled frame when it presents; a profiler enabled mid-frame starts with the next.
+  // Only use it on the thread that owns the GL context. One instance is shared per
+  // context through Context::Shared.
+  class GpuProfiler {
+    public:
+    GpuProfiler(const GpuProfiler&) = default;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    GpuProfiler( );
+    ~GpuProfiler( );
+
+    // The current context's profiler.
+    static std::shared_ptr<GpuProfiler> Shared( );
+
+    // Frames still waiting for their results once this many newer ones have finished
+    // are read anyway, blocking until the GPU gets there.
+    static const uint32_t Latency = 3;
+
+    void Enable(bool enabled);
+    const bool Enabled( );
+
+    // The name must stay valid until the report has been read; string literals are
+    // intended. Begin returns false when no frame is being profiled, and End then
+    // does nothing either.
+    bool Begin(const char* name);
+    void End( );
+
+    // Called by the context just before presenting.
+    void Frame( );
+
+    // The most recent frame whose results are in; Frame is zero until there is one.
+    const GpuFrameReport& Report( );
+
+    private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    struct Marker {
+      const char* Name;
+      uint32_t Depth;
+      Clock::time_point CpuBegin, CpuEnd;
+      uint32_t QueryBegin, QueryEnd;
+    };
+
+    struct FrameRecord {
+      uint64_t Number;
+      Clock::time_point CpuBegin, CpuEnd;
+      uint32_t QueryBegin, QueryEnd;
+      std::vector<Marker> Markers;
+    };
+
+    bool _enabled, _profiling;
+    uint64_t _frame;
+    FrameRecord _current;
+    std::vector<size_t> _open;
+    std::deque<FrameRecord> _pending;
+    std::vector<uint32_t> _queries;
+    GpuFrameReport _report;
+
+    uint32_t Timestamp( );
+    void Resolve(FrameRecord& frame);
+  };
+
+  // Times the enclosing block with the given profiler.
+  class GpuProfileScope {
+    public:
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+    GpuProfileScope(GpuProfiler& profiler, const char* name)
+      : _profiler(profiler)
+      , _open(profiler.Begin(name)) {
+
+    }
+
+    ~GpuProfileScope( ) {
+      if (_open) _profiler.End( );
+    }
+
+    private:
+    GpuProfiler& _profiler;
+    const bool _open;
+  };
+
+}
\ No newline at end of file
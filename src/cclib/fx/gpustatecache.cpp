@@ -0,0 +1,128 @@
+#include "stdafx.h"
+#include "gpustatecache.h"
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+  // Never a valid name or enum, so the first call of each kind always reaches GL.
+  static const uint32_t Unknown = 0xFFFFFFFF;
+
+  static int TextureTarget(uint32_t target) {
+    if (target == GL_TEXTURE_2D) return 0;
+    if (target == GL_TEXTURE_2D_ARRAY) return 1;
+    return -1;
+  }
+
+  GpuStateCache::GpuStateCache( ) {
+    Invalidate( );
+    ResetStats( );
+  }
+
+  GpuStateCache::~GpuStateCache( ) {
+
+  }
+
+  std::shared_ptr<GpuStateCache> GpuStateCache::Shared( ) {
+    auto context = Context::Current( );
+    if (!context) {
+      throw EngineException("GPU state can only be changed with a current context.", ErrorCode::FX_NO_CONTEXT);
+    }
+    return context->Shared<GpuStateCache>( );
+  }
+
+  bool GpuStateCache::Changed(uint32_t& current, uint32_t value) {
+    if (current == value) {
+      _stats.Avoided++;
+      return false;
+    }
+    current = value;
+    _stats.Issued++;
+    return true;
+  }
+
+  void GpuStateCache::UseProgram(uint32_t program) {
+    if (Changed(_program, program)) glUseProgram(program);
+  }
+
+  void GpuStateCache::BindVertexArray(uint32_t vao) {
+    if (Changed(_vao, vao)) glBindVertexArray(vao);
+  }
+
+  void GpuStateCache::ActiveTexture(uint32_t unit) {
+    if (Changed(_unit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+  }
+
+  void GpuStateCache::BindTexture(uint32_t target, uint32_t texture) {
+    auto index = TextureTarget(target);
+    if (index < 0 || _unit >= TextureUnits) {
+      _stats.Issued++;
+      glBindTexture(target, texture);
+      return;
+    }
+    if (Changed(_textures[_unit][index], texture)) glBindTexture(target, texture);
+  }
+
+  void GpuStateCache::Blend(bool enabled, uint32_t source, uint32_t destination) {
+    if (Changed(_blend, enabled ? 1 : 0)) {
+      if (enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    }
+    if (!enabled) return;
+
+    if (_blendSource != source || _blendDestination != destination) {
+      _blendSource = source;
+      _blendDestination = destination;
+      _stats.Issued++;
+      glBlendFunc(source, destination);
+    } else {
+      _stats.Avoided++;
+    }
+  }
+
+  void GpuStateCache::TextureDeleted(uint32_t texture) {
+    if (!Context::Current( )) return;
+    auto cache = Shared( );
+    for (uint32_t unit = 0; unit < TextureUnits; ++unit) {
+      for (int target = 0; target < 2; ++target) {
+        if (cache->_textures[unit][target] == texture) cache->_textures[unit][target] = 0;
+      }
+    }
+  }
+
+  void GpuStateCache::VertexArrayDeleted(uint32_t vao) {
+    if (!Context::Current( )) return;
+    auto cache = Shared( );
+    if (cache->_vao == vao) cache->_vao = 0;
+  }
+
+  void GpuStateCache::Invalidate( ) {
+    _program = Unknown;
+    _vao = Unknown;
+
+    // Texture bindings are per unit, so the unit itself has to be known.
+    GLint unit = GL_TEXTURE0;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &unit);
+    _unit = unit - GL_TEXTURE0;
+    for (uint32_t unit = 0; unit < TextureUnits; ++unit) {
+      _textures[unit][0] = Unknown;
+      _textures[unit][1] = Unknown;
+    }
+    _blend = Unknown;
+    _blendSource = Unknown;
+    _blendDestination = Unknown;
+  }
+
+  const GpuStateStats& GpuStateCache::Stats( ) {
+    return _stats;
+  }
+
+  void GpuStateCache::ResetStats( ) {
+    _stats.Issued = 0;
+    _stats.Avoided = 0;
+  }
+
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+
+namespace fx {
+
+  struct GpuStateStats {
+    uint32_t Issued;
+    uint32_t Avoided;
+  };
+
+  // Shadows the GL state the engine changes most, so that setting a value that is
+  // already current makes no GL call. Everything in the engine binds programs, vertex
+  // arrays and textures and sets blending through here; code that changes that state
+  // behind its back must call Invalidate. One instance is shared per context through
+  // Context::Shared.
+  class GpuStateCache {
+    public:
+    GpuStateCache(const GpuStateCache&) = default;
+    GpuStateCache& operator=(const GpuStateCache&) = delete;
+
+    GpuStateCache( );
+    ~GpuStateCache( );
+
+    // The current context's cache.
+    static std::shared_ptr<GpuStateCache> Shared( );
+
+    void UseProgram(uint32_t program);
+    void BindVertexArray(uint32_t vao);
+    void ActiveTexture(uint32_t unit);
+    // GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY are tracked; other targets always bind.
+    void BindTexture(uint32_t target, uint32_t texture);
+    void Blend(bool enabled, uint32_t source = 0, uint32_t destination = 0);
+
+    // GL unbinds deleted objects; call these after deleting so that a recycled name
+    // is not mistaken for the old binding. Safe to call without a current context, but
+    // with a render thread only on that thread, which is where Context::Release runs.
+    static void TextureDeleted(uint32_t texture);
+    static void VertexArrayDeleted(uint32_t vao);
+
+    // Forgets everything, so that the next call of each kind reaches GL.
+    void Invalidate( );
+
+    const GpuStateStats& Stats( );
+    void ResetStats( );
+
+    private:
+    static const uint32_t TextureUnits = 16;
+
+    uint32_t _program, _vao, _unit;
+    uint32_t _textures[TextureUnits][2];
+    uint32_t _blend, _blendSource, _blendDestination;
+    GpuStateStats _stats;
+
+    bool Changed(uint32_t& current, uint32_t value);
+  };
+
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "programcache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "../content/contentpack.h"
+#include "../logging.h"
+
+namespace fx {
+
+  static const char ProgramBinaryMagic[4] = { 'C', 'C', 'P', 'B' };
+  static const uint32_t ProgramBinaryVersion = 1;
+
+  struct ProgramBinaryHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t Driver;
+    uint32_t Format;
+    uint32_t Size;
+  };
+
+  ProgramCache::ProgramCache(const std::string directory)
+    : _directory(directory) {
+
+  }
+
+  ProgramCache::~ProgramCache( ) {
+
+  }
+
+  std::shared_ptr<ProgramBinary> ProgramCache::Read(uint64_t key) {
+    std::ifstream file(FileName(key), std::ios::in | std::ios::binary);
+    if (!file.is_open( )) return nullptr;
+
+    ProgramBinaryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.Magic, ProgramBinaryMagic, sizeof(header.Magic)) != 0 ||
+        header.Version != ProgramBinaryVersion) {
+      return nullptr;
+    }
+
+    auto binary = std::make_shared<ProgramBinary>( );
+    binary->Driver = header.Driver;
+    binary->Format = header.Format;
+    binary->Data.resize(header.Size);
+    if (!file.read(reinterpret_cast<char*>(binary->Data.data( )), header.Size)) return nullptr;
+    return binary;
+  }
+
+  uint32_t ProgramCache::Load(const ProgramBinary& binary) {
+    if (!Supported( ) || binary.Driver != Driver( )) return 0;
+
+    auto programId = glCreateProgram( );
+    glProgramBinary(programId, binary.Format, binary.Data.data( ), (GLsizei) binary.Data.size( ));
+
+    // Drivers reject binaries after updates or hardware changes; the caller compiles instead.
+    GLint result = GL_FALSE;
+    glGetProgramiv(programId, GL_LINK_STATUS, &result);
+    if (!result) {
+      glDeleteProgram(programId);
+      return 0;
+    }
+    return programId;
+  }
+
+  void ProgramCache::Prepare(uint32_t program) {
+    if (Supported( )) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
+  void ProgramCache::Store(uint64_t key, uint32_t program) {
+    if (!Supported( )) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    ProgramBinaryHeader header;
+    memcpy(header.Magic, ProgramBinaryMagic, sizeof(header.Magic));
+    header.Version = ProgramBinaryVersion;
+    header.Driver = Driver( );
+
+    std::vector<uint8_t> data(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, data.data( ));
+    header.Format = format;
+    header.Size = (uint32_t) length;
+
+    std::tr2::sys::create_directories(std::tr2::sys::path(_directory));
+    std::ofstream file(FileName(key), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+        !file.write(reinterpret_cast<const char*>(data.data( )), header.Size)) {
+      LOG(WARNING) << L"Failed to write program binary to " << FileName(key) << L" .";
+    }
+  }
+
+  const bool ProgramCache::Supported( ) {
+    if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1) return false;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+  }
+
+  const uint64_t ProgramCache::Driver( ) {
+    auto vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+    auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    return content::ContentPack::Hash(std::string(vendor ? vendor : "") + "\n" + (renderer ? renderer : "") + "\n" + (version ? version : ""));
+  }
+
+  const std::string ProgramCache::FileName(uint64_t key) {
+    char name[24];
+    sprintf(name, "%016llx.bin", (unsigned long long) key);
+    return (std::tr2::sys::path(_directory) / name).string( );
+  }
+
+}
\ No newline at end of file
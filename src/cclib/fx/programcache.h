@@ -0,0 +1,46 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace fx {
+
+  struct ProgramBinary {
+    uint64_t Driver;
+    uint32_t Format;
+    std::vector<uint8_t> Data;
+  };
+
+  // Linked program binaries kept on disk between runs, one file per key. The key
+  // should identify everything the program was built from; the driver that produced
+  // a binary is recorded with it and checked again before the binary is used.
+  class ProgramCache {
+    public:
+    ProgramCache(const ProgramCache&) = default;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    ProgramCache(const std::string directory);
+    ~ProgramCache( );
+
+    // Any thread. Null if nothing is cached for the key.
+    std::shared_ptr<ProgramBinary> Read(uint64_t key);
+
+    // GL thread only. Creates a program from the binary, or returns zero if it was
+    // made by another driver or the driver rejects it.
+    uint32_t Load(const ProgramBinary& binary);
+
+    // GL thread only. Call before linking so that the driver keeps the binary.
+    void Prepare(uint32_t program);
+    // GL thread only. Saves a successfully linked program's binary.
+    void Store(uint64_t key, uint32_t program);
+
+    private:
+    const std::string _directory;
+
+    const bool Supported( );
+    const uint64_t Driver( );
+    const std::string FileName(uint64_t key);
+  };
+
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "stdafx.h"
+#include "quadindexbuffer.h"
+
+#include <vector>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+  template<typename T> static std::vector<T> BuildQuadIndices(uint32_t quads) {
+    std::vector<T> indices(quads * 6);
+    for (uint32_t quad = 0; quad < quads; ++quad) {
+      T i1 = (T) (quad * 4), i2 = i1 + 1, i3 = i2 + 1, i4 = i3 + 1;
+      auto index = &indices[quad * 6];
+      index[0] = i1;
+      index[1] = i3;
+      index[2] = i4;
+      index[3] = i1;
+      index[4] = i2;
+      index[5] = i3;
+    }
+    return indices;
+  }
+
+  QuadIndexBuffer::QuadIndexBuffer( )
+    : _ibo(0)
+    , _capacity(0)
+    , _indexType(GL_UNSIGNED_SHORT) {
+
+  }
+
+  QuadIndexBuffer::~QuadIndexBuffer( ) {
+    if (_ibo != 0) glDeleteBuffers(1, &_ibo);
+  }
+
+  std::shared_ptr<QuadIndexBuffer> QuadIndexBuffer::Shared(uint32_t quads) {
+    auto context = Context::Current( );
+    if (!context) {
+      throw EngineException("Quad indices can only be created with a current context.", ErrorCode::FX_NO_CONTEXT);
+    }
+    auto indices = context->Shared<QuadIndexBuffer>( );
+    indices->Reserve(quads);
+    return indices;
+  }
+
+  void QuadIndexBuffer::Reserve(uint32_t quads) {
+    if (quads <= _capacity) return;
+
+    // Use 16-bit indices for as long as every vertex index fits in them.
+    const bool shortIndices = quads * 4 <= 0x10000;
+    std::vector<uint16_t> shorts;
+    std::vector<uint32_t> ints;
+    const void* data;
+    GLsizeiptr size;
+    if (shortIndices) {
+      shorts = BuildQuadIndices<uint16_t>(quads);
+      data = &shorts[0];
+      size = shorts.size( ) * sizeof(uint16_t);
+    } else {
+      ints = BuildQuadIndices<uint32_t>(quads);
+      data = &ints[0];
+      size = ints.size( ) * sizeof(uint32_t);
+    }
+
+    if (_ibo != 0) glDeleteBuffers(1, &_ibo);
+    glGenBuffers(1, &_ibo);
+
+    // Upload through the copy target so that no vertex array's element binding is disturbed.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _ibo);
+    if (GLEW_ARB_buffer_storage || GLEW_VERSION_4_4) {
+      glBufferStorage(GL_COPY_WRITE_BUFFER, size, data, 0);
+    } else {
+      glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    _capacity = quads;
+    _indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  }
+
+  const uint32_t QuadIndexBuffer::Ibo( ) {
+    return _ibo;
+  }
+
+  const uint32_t QuadIndexBuffer::Capacity( ) {
+    return _capacity;
+  }
+
+  const uint32_t QuadIndexBuffer::IndexType( ) {
+    return _indexType;
+  }
+
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+
+namespace fx {
+
+  // An immutable element buffer holding the (i1, i3, i4, i1, i2, i3) pattern for
+  // consecutive quads. One instance is shared per context through Context::Shared.
+  class QuadIndexBuffer {
+    public:
+    QuadIndexBuffer(const QuadIndexBuffer&) = default;
+    QuadIndexBuffer& operator=(const QuadIndexBuffer&) = delete;
+
+    QuadIndexBuffer( );
+    ~QuadIndexBuffer( );
+
+    // The current context's buffer, grown to hold at least quads quads.
+    static std::shared_ptr<QuadIndexBuffer> Shared(uint32_t quads);
+
+    void Reserve(uint32_t quads);
+
+    const uint32_t Ibo( );
+    const uint32_t Capacity( );
+    const uint32_t IndexType( );
+
+    private:
+    uint32_t _ibo, _capacity, _indexType;
+  };
+
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "stdafx.h"
+#include "renderqueue.h"
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "spritecommandbuffer.h"
+#include "../engineexception.h"
+#include "../radixsort.h"
+
+namespace fx {
+
+  // The low bits of every key hold the packet's submission index, which keeps the
+  // sort stable and finds the packet again afterwards.
+  static const uint32_t SequenceBits = 20;
+  static const uint64_t SequenceMask = (1ull << SequenceBits) - 1;
+
+  RenderQueue::RenderQueue( )
+    : _state(GpuStateCache::Shared( )) {
+    ResetStats( );
+  }
+
+  RenderQueue::~RenderQueue( ) {
+
+  }
+
+  uint64_t RenderQueue::Key(uint32_t layer, bool blended, uint32_t shader, uint32_t texture, float depth) {
+    uint64_t key = (uint64_t) (layer & 0xF) << 60;
+    if (blended) {
+      // layer:4 | 1 | depth:24 back to front | unused:15 | sequence:20
+      key |= 1ull << 59;
+      key |= (uint64_t) (~radix_float_key(depth) >> 8) << 35;
+    } else {
+      // layer:4 | 0 | shader:12 | texture:12 | depth:15 front to back | sequence:20
+      key |= (uint64_t) (shader & 0xFFF) << 47;
+      key |= (uint64_t) (texture & 0xFFF) << 35;
+      key |= (uint64_t) (radix_float_key(depth) >> 17) << 20;
+    }
+    return key;
+  }
+
+  void RenderQueue::Submit(uint64_t key, Shader* shader, uint32_t texture, const std::function<void( )>& draw) {
+    if (_packets.size( ) > SequenceMask) {
+      throw EngineException("Too many packets in the render queue.", ErrorCode::FX_BUFFER_OVERFLOW);
+    }
+
+    RenderPacket packet = { key, shader, texture, draw };
+    _keys.push_back((key & ~SequenceMask) | _packets.size( ));
+    _packets.push_back(packet);
+  }
+
+  void RenderQueue::Submit(Shader& shader, uint32_t texture, uint32_t layer, float depth, const std::function<void( )>& draw) {
+    Submit(Key(layer, shader.Blended( ), shader.Id( ), texture, depth), &shader, texture, draw);
+  }
+
+  void RenderQueue::Execute( ) {
+    // Bytes below the third only hold the sequence, which is already in order.
+    radix_sort(_keys, _scratch, SequenceBits / 8);
+
+    Shader* shader = nullptr;
+    uint32_t texture = 0;
+    for (auto it = _keys.begin( ); it != _keys.end( ); ++it) {
+      auto& packet = _packets[(size_t) (*it & SequenceMask)];
+
+      if (packet.Shader && packet.Shader != shader) {
+        packet.Shader->Apply( );
+        shader = packet.Shader;
+        _stats.ShaderChanges++;
+      }
+      if (packet.Texture != 0 && packet.Texture != texture) {
+        if (packet.Texture & ArrayTextureKey) {
+          _state->BindTexture(GL_TEXTURE_2D_ARRAY, packet.Texture & ~ArrayTextureKey);
+        } else {
+          _state->BindTexture(GL_TEXTURE_2D, packet.Texture);
+        }
+        texture = packet.Texture;
+        _stats.TextureChanges++;
+      }
+
+      packet.Draw( );
+      _stats.Packets++;
+    }
+
+    _packets.clear( );
+    _keys.clear( );
+  }
+
+  const size_t RenderQueue::Size( ) {
+    return _packets.size( );
+  }
+
+  const RenderQueueStats& RenderQueue::Stats( ) {
+    return _stats;
+  }
+
+  void RenderQueue::ResetStats( ) {
+    _stats.Packets = 0;
+    _stats.ShaderChanges = 0;
+    _stats.TextureChanges = 0;
+  }
+
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "gpustatecache.h"
+#include "shader.h"
+
+namespace fx {
+
+  struct RenderQueueStats {
+    uint32_t Packets;
+    uint32_t ShaderChanges;
+    uint32_t TextureChanges;
+  };
+
+  // A deferred draw. The texture uses the same convention as sprites: a GL name, with
+  // ArrayTextureKey set for array textures, or zero to leave the binding alone.
+  struct RenderPacket {
+    uint64_t Key;
+    Shader* Shader;
+    uint32_t Texture;
+    std::function<void( )> Draw;
+  };
+
+  // Collects draws from independent systems during a frame and issues them together,
+  // radix-sorted on a 64-bit key, so that draws sharing a shader or texture run back
+  // to back. Opaque draws sort by layer, shader, texture and then depth front to back.
+  // Blended draws come after the opaque ones of their layer and sort back to front by
+  // depth alone, so that blending stays correct. Equal keys keep submission order.
+  class RenderQueue {
+    public:
+    RenderQueue(const RenderQueue&) = default;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    RenderQueue( );
+    ~RenderQueue( );
+
+    // Layers 0 to 15 are drawn in order. Higher depth is further back.
+    static uint64_t Key(uint32_t layer, bool blended, uint32_t shader, uint32_t texture, float depth);
+
+    // Draw runs during Execute with the shader applied and the texture bound. A
+    // null shader leaves the current program alone.
+    void Submit(uint64_t key, Shader* shader, uint32_t texture, const std::function<void( )>& draw);
+    void Submit(Shader& shader, uint32_t texture, uint32_t layer, float depth, const std::function<void( )>& draw);
+
+    // Sorts and draws everything submitted since the last call, then empties the queue.
+    void Execute( );
+    const size_t Size( );
+
+    const RenderQueueStats& Stats( );
+    void ResetStats( );
+
+    private:
+    std::vector<RenderPacket> _packets;
+    std::vector<uint64_t> _keys, _scratch;
+    std::shared_ptr<GpuStateCache> _state;
+    RenderQueueStats _stats;
+  };
+
+}
\ No newline at end of file
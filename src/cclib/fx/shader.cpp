@@ -9,9 +9,14 @@
 #include <gl/glew.h>
 #include <gl/glfw3.h>
 #include <rapidjson/document.h>
+#include <rapidjson/memorystream.h>
 
+#include "programcache.h"
+#include "shadercompiler.h"
+#include "uniformbuffer.h"
 #include "../logging.h"
 #include "../content/contentmanager.h"
+#include "../content/contentpack.h"
 #include "../math.h"
 
 using namespace std;
@@ -35,24 +40,61 @@ namespace fx {
 
     }
 
+    const bool Blended( ) {
+      return _blend_enabled;
+    }
+
     void Apply( ) override {
-      if (_blend_enabled) {
-        glEnable(GL_BLEND);
-        glBlendFunc(_blend_src, _blend_dst);
-      } else {
-        glDisable(GL_BLEND);
-      }
+      GpuStateCache::Shared( )->Blend(_blend_enabled, _blend_src, _blend_dst);
     }
   };
 
+  static void LogProgramInfo(uint32_t programId) {
+    int infoLogLength;
+    glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+    if (infoLogLength > 0) {
+      auto errorMessage = vector<char>(infoLogLength + 1);
+      glGetProgramInfoLog(programId, infoLogLength, NULL, &errorMessage[0]);
+      if (errorMessage[0] != '\0')
+        LOG(ERROR) << &errorMessage[0];
+    }
+  }
+
+  static void LogShaderInfo(uint32_t shaderId) {
+    int infoLogLength;
+    glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+    if (infoLogLength > 0) {
+      auto errorMessage = vector<char>(infoLogLength + 1);
+      glGetShaderInfoLog(shaderId, infoLogLength, NULL, &errorMessage[0]);
+      if (errorMessage[0] != '\0')
+        LOG(ERROR) << &errorMessage[0];
+    }
+  }
+
   Shader::Shader(
     const uint32_t id,
     const unordered_map<uint32_t, shared_ptr<IShaderProgram>>& programs,
-    const vector<shared_ptr<IGpuState>>& states) :
+    const vector<shared_ptr<IGpuState>>& states,
+    const function<void( )>& linked,
+    const string path) :
     _id(id),
     _programs(programs),
-    _states(states) {
-
+    _states(states),
+    _linked(linked),
+    _path(path),
+    _ready(!linked),
+    _failed(false),
+    _state(GpuStateCache::Shared( )),
+    _profiler(GpuProfiler::Shared( )),
+    _blended(false),
+    _introspected(false) {
+    for (auto it = _states.begin( ); it != _states.end( ); ++it) {
+      auto fragment = dynamic_cast<FragmentShaderState*>(it->get( ));
+      if (fragment && fragment->Blended( )) _blended = true;
+    }
+    if (_ready) Introspect( );
   }
 
   Shader::~Shader( ) {
@@ -63,15 +105,93 @@ namespace fx {
     return _id;
   }
 
+  const bool Shader::Blended( ) {
+    return _blended;
+  }
+
+  const bool Shader::Ready( ) {
+    if (_ready) return true;
+    if (_failed) {
+      throw EngineException("Failed to link shader program: " + _path, ErrorCode::FX_SHADER_COMPILE_FAILURE);
+    }
+    if (!ShaderCompiler::Shared( )->ProgramCompleted(_id)) return false;
+
+    GLint result = GL_FALSE;
+    glGetProgramiv(_id, GL_LINK_STATUS, &result);
+    if (!result) {
+      // The stages' compile status was never checked, so their logs hold the cause.
+      for (auto it = _programs.begin( ); it != _programs.end( ); ++it) {
+        LogShaderInfo(it->second->Id( ));
+      }
+      LogProgramInfo(_id);
+      glDeleteProgram(_id);
+      _failed = true;
+      _linked = nullptr;
+      throw EngineException("Failed to link shader program: " + _path, ErrorCode::FX_SHADER_COMPILE_FAILURE);
+    }
+    LogProgramInfo(_id);
+
+    _ready = true;
+    Introspect( );
+    _linked( );
+    _linked = nullptr;
+    return true;
+  }
+
   void Shader::Apply( ) {
-    glUseProgram(_id);
+    GpuProfileScope scope(*_profiler, "Shader::Apply");
+    if (!_ready) Ready( );
+    _state->UseProgram(_id);
     for (auto it = _states.begin( ); it != _states.end( ); ++it) {
       (*it)->Apply( );
     }
   }
 
   uint32_t Shader::Uniform(const std::string name) {
-    return glGetUniformLocation(_id, name.c_str( ));
+    // Still linking: this waits for it, just as glGetUniformLocation would.
+    if (!_introspected) Introspect( );
+
+    auto location = _uniforms.find(name);
+    if (location != _uniforms.end( )) return location->second;
+
+    // Names the introspection does not list, like single array elements.
+    auto id = (uint32_t) glGetUniformLocation(_id, name.c_str( ));
+    _uniforms[name] = id;
+    return id;
+  }
+
+  void Shader::Introspect( ) {
+    _introspected = true;
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(_id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    auto name = vector<char>(maxLength + 1);
+    for (GLint i = 0; i < count; ++i) {
+      GLsizei length = 0;
+      GLint size;
+      GLenum type;
+      glGetActiveUniform(_id, i, maxLength, &length, &size, &type, &name[0]);
+
+      // Members of uniform blocks have no location.
+      auto location = glGetUniformLocation(_id, &name[0]);
+      if (location < 0) continue;
+
+      auto uniform = string(&name[0], length);
+      _uniforms[uniform] = location;
+
+      // Arrays are listed as "name[0]" but can also be set through the bare name.
+      if (uniform.size( ) > 3 && uniform.compare(uniform.size( ) - 3, 3, "[0]") == 0) {
+        _uniforms[uniform.substr(0, uniform.size( ) - 3)] = location;
+      }
+    }
+
+    // GLSL 330 has no binding layout qualifier, so the block is bound here.
+    auto frame = glGetUniformBlockIndex(_id, "Frame");
+    if (frame != GL_INVALID_INDEX) {
+      glUniformBlockBinding(_id, frame, FrameUniformBinding);
+    }
   }
 
   template<> void Shader::Uniform<math::mat2>(const uint32_t id, const math::mat2& value) {
@@ -89,44 +209,6 @@ namespace fx {
 
 namespace content {
 
-  class IStreamWrapper {
-    public:
-    typedef char Ch;
-
-    IStreamWrapper(istream& is) : _is(is) {
-    }
-
-    Ch Peek( ) const {
-      int c = _is.peek( );
-      return c == char_traits<char>::eof( ) ? '\0' : (Ch) c;
-    }
-    Ch Take( ) {
-      int c = _is.get( );
-      return c == char_traits<char>::eof( ) ? '\0' : (Ch) c;
-    }
-    size_t Tell( ) const {
-      return (size_t) _is.tellg( );
-    }
-
-    Ch* PutBegin( ) {
-      assert(false); return 0;
-    }
-    void Put(Ch) {
-      assert(false);
-    }
-    void Flush( ) {
-      assert(false);
-    }
-    size_t PutEnd(Ch*) {
-      assert(false); return 0;
-    }
-
-    private:
-    IStreamWrapper(const IStreamWrapper&);
-    IStreamWrapper& operator=(const IStreamWrapper&);
-    istream& _is;
-  };
-
   uint32_t ReadBlendFunc(rapidjson::Value& value, bool& enabled) {
     auto str = string(value.GetString( ));
     enabled = true;
@@ -176,8 +258,8 @@ namespace content {
     return make_shared<fx::FragmentShaderState>(blend_enabled, blend_src, blend_dst);
   }
 
-  template<> shared_ptr<fx::Shader> ContentManager::LoadContent<fx::Shader>(const LoadOperation& operation) {
-    IStreamWrapper stream(*operation.Data.get( ));
+  template<> function<shared_ptr<fx::Shader>( )> ContentManager::PrepareContent<fx::Shader>(const LoadOperation& operation) {
+    rapidjson::MemoryStream stream(reinterpret_cast<const char*>(operation.Data->Data( )), operation.Data->Size( ));
     rapidjson::Document d;
     d.ParseStream(stream);
 
@@ -189,9 +271,12 @@ namespace content {
       throw EngineException("Expected 'sources' object member: " + operation.Path, ErrorCode::CONTENT_INVALID_DATA);
 
     unordered_set<string> seenMembers;
-    unordered_map<uint32_t, shared_ptr<fx::IShaderProgram>> programs;
+    unordered_map<uint32_t, function<shared_ptr<fx::IShaderProgram>( )>> prepared;
     vector<shared_ptr<fx::IGpuState>> states;
 
+    // The binary cache key covers this file and every source it names.
+    auto keyData = string(reinterpret_cast<const char*>(operation.Data->Data( )), operation.Data->Size( ));
+
     for (auto it = sources->value.MemberBegin( ); it != sources->value.MemberEnd( ); ++it) {
       auto name = string(it->name.GetString( ));
       auto& value = it->value;
@@ -206,51 +291,86 @@ namespace content {
       if (!file.IsString( ))
         throw EngineException("The 'sources." + name + "' member must have a file member that is a string: " + operation.Path, ErrorCode::CONTENT_INVALID_DATA);
 
+      string extension;
       if (name == "fragment") {
 
-        programs[fx::FragmentShaderProgram::ShaderType] =
-          operation.ContentManager.LoadContent<fx::FragmentShaderProgram>(operation.Path, string(file.GetString( )));
+        prepared[fx::FragmentShaderProgram::ShaderType] =
+          operation.ContentManager.Prepare<fx::FragmentShaderProgram>(operation.Path, string(file.GetString( )));
         states.push_back(ReadFragmentState(operation, value));
+        extension = ContentExtension<fx::FragmentShaderProgram>( );
 
       } else if (name == "vertex") {
 
-        programs[fx::VertexShaderProgram::ShaderType] =
-          operation.ContentManager.LoadContent<fx::VertexShaderProgram>(operation.Path, string(file.GetString( )));
+        prepared[fx::VertexShaderProgram::ShaderType] =
+          operation.ContentManager.Prepare<fx::VertexShaderProgram>(operation.Path, string(file.GetString( )));
+        extension = ContentExtension<fx::VertexShaderProgram>( );
 
       } else {
         throw EngineException("The 'sources." + name + "' is not supported: " + operation.Path, ErrorCode::CONTENT_INVALID_DATA);
       }
+
+      string fullPath, relativePath;
+      operation.ContentManager.Resolve(operation.ContentManager.Combine(operation.Path, string(file.GetString( ))) + extension, fullPath, relativePath);
+      auto source = operation.ContentManager.Open(fullPath, relativePath);
+      keyData.append(reinterpret_cast<const char*>(source->Data( )), source->Size( ));
     }
 
-    GLint result = GL_FALSE;
-    int infoLogLength;
+    auto key = ContentPack::Hash(keyData);
+    auto cache = make_shared<fx::ProgramCache>((operation.ContentManager._basePath / "shadercache").string( ));
+    auto binary = cache->Read(key);
+
+    // The programs are compiled on the GL thread along with the link.
+    auto path = operation.Path;
+    return [prepared, states, path, key, cache, binary]( ) -> shared_ptr<fx::Shader> {
+      if (binary) {
+        auto programId = cache->Load(*binary);
+        if (programId != 0) {
+          LOG(DEBUG) << L"Loaded cached program binary for " << path << L" .";
+          return make_shared<fx::Shader>(programId, unordered_map<uint32_t, shared_ptr<fx::IShaderProgram>>( ), states);
+        }
+        LOG(DEBUG) << L"Cached program binary rejected for " << path << L", compiling.";
+      }
 
-    auto programId = glCreateProgram( );
-    for (auto it = programs.begin( ); it != programs.end( ); ++it) {
-      glAttachShader(programId, it->second->Id( ));
-    }
-    glLinkProgram(programId);
+      unordered_map<uint32_t, shared_ptr<fx::IShaderProgram>> programs;
+      for (auto it = prepared.begin( ); it != prepared.end( ); ++it) {
+        programs[it->first] = it->second( );
+      }
 
-    glGetProgramiv(programId, GL_LINK_STATUS, &result);
-    glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &infoLogLength);
+      auto programId = glCreateProgram( );
+      for (auto it = programs.begin( ); it != programs.end( ); ++it) {
+        glAttachShader(programId, it->second->Id( ));
+      }
+      cache->Prepare(programId);
+      glLinkProgram(programId);
+
+      // With parallel compilation the link is checked, and the binary saved, once the
+      // driver reports it complete.
+      if (fx::ShaderCompiler::Shared( )->Parallel( )) {
+        return make_shared<fx::Shader>(programId, programs, states, [cache, key, programId]( ) {
+          cache->Store(key, programId);
+        }, path);
+      }
 
-    if (infoLogLength > 0) {
-      auto errorMessage = vector<char>(infoLogLength + 1);
-      glGetProgramInfoLog(programId, infoLogLength, NULL, &errorMessage[0]);
-      if (errorMessage[0] != '\0')
-        LOG(ERROR) << &errorMessage[0];
-    }
+      GLint result = GL_FALSE;
+      glGetProgramiv(programId, GL_LINK_STATUS, &result);
+      fx::LogProgramInfo(programId);
 
-    if (!result) {
-      glDeleteProgram(programId);
-      throw EngineException("Failed to link shader program: " + operation.Path, ErrorCode::FX_SHADER_COMPILE_FAILURE);
-    }
+      if (!result) {
+        glDeleteProgram(programId);
+        throw EngineException("Failed to link shader program: " + path, ErrorCode::FX_SHADER_COMPILE_FAILURE);
+      }
 
-    return make_shared<fx::Shader>(programId, programs, states);
+      cache->Store(key, programId);
+      return make_shared<fx::Shader>(programId, programs, states);
+    };
   }
 
   template<> const string ContentManager::ContentExtension<fx::Shader>( ) {
     return ".json";
   }
 
+  template<> const size_t ContentManager::ContentSize<fx::Shader>(fx::Shader& content) {
+    return 0;
+  }
+
 }
\ No newline at end of file
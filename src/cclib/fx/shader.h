@@ -1,9 +1,12 @@
 #pragma once
+#include <functional>
 #include <memory>
 #include <stdint.h>
 #include <string>
 #include <unordered_map>
 
+#include "gpuprofiler.h"
+#include "gpustatecache.h"
 #include "igpustate.h"
 #include "shaderprogram.h"
 
@@ -17,14 +20,29 @@ namespace fx {
     Shader(
       const uint32_t id,
       const std::unordered_map<uint32_t, std::shared_ptr<IShaderProgram>>& programs,
-      const std::vector<std::shared_ptr<fx::IGpuState>>& states);
+      const std::vector<std::shared_ptr<fx::IGpuState>>& states,
+      const std::function<void( )>& linked = nullptr,
+      const std::string path = "");
     ~Shader( );
 
+    // A shader created with a linked callback is still linking on the driver's
+    // threads. Ready polls it without blocking, throws FX_SHADER_COMPILE_FAILURE naming
+    // the path if the link failed and runs the callback once it succeeded. A failed
+    // program is deleted, and every later call throws again. Apply checks it as well.
+    const bool Ready( );
+
+    // Locations come from a table filled by introspecting the linked program, so
+    // looking one up does not go to the driver. A block named Frame is bound to
+    // FrameUniformBinding at the same time.
     uint32_t Uniform(const std::string name);
     template<typename T> void Uniform(const uint32_t id, const T& value);
     template<typename T> void Uniform(const std::string name, const T& value);
 
     const uint32_t Id( );
+    // Whether the shader's states enable blending, which decides how a RenderQueue
+    // orders its draws.
+    const bool Blended( );
+    // Null for shaders created from the program binary cache, which have no stages.
     template<typename T> std::shared_ptr<T> Program( );
 
     void Apply( ) override;
@@ -33,6 +51,17 @@ namespace fx {
     const uint32_t _id;
     const std::unordered_map<uint32_t, std::shared_ptr<IShaderProgram>> _programs;
     const std::vector<std::shared_ptr<fx::IGpuState>> _states;
+    std::function<void( )> _linked;
+    const std::string _path;
+    bool _ready, _failed;
+    std::shared_ptr<GpuStateCache> _state;
+    std::shared_ptr<GpuProfiler> _profiler;
+    bool _blended;
+
+    std::unordered_map<std::string, uint32_t> _uniforms;
+    bool _introspected;
+
+    void Introspect( );
   };
 
   template<typename T> std::shared_ptr<T> Shader::Program( ) {
@@ -0,0 +1,64 @@
+#include "stdafx.h"
+#include "shadercompiler.h"
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "../engineexception.h"
+#include "../logging.h"
+
+// Our GLEW predates KHR_parallel_shader_compile, so its bits are declared here.
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace fx {
+
+  typedef void (APIENTRY *MaxShaderCompilerThreadsProc)(GLuint count);
+
+  ShaderCompiler::ShaderCompiler( )
+    : _parallel(false) {
+    MaxShaderCompilerThreadsProc maxThreads = nullptr;
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+      maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+    } else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+      maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+    }
+
+    if (maxThreads) {
+      // Let the driver pick how many threads to use.
+      maxThreads(0xFFFFFFFF);
+      _parallel = true;
+      LOG(DEBUG) << L"Parallel shader compilation enabled.";
+    }
+  }
+
+  ShaderCompiler::~ShaderCompiler( ) {
+
+  }
+
+  std::shared_ptr<ShaderCompiler> ShaderCompiler::Shared( ) {
+    auto context = Context::Current( );
+    if (!context) {
+      throw EngineException("Shaders can only be compiled with a current context.", ErrorCode::FX_NO_CONTEXT);
+    }
+    return context->Shared<ShaderCompiler>( );
+  }
+
+  const bool ShaderCompiler::Parallel( ) {
+    return _parallel;
+  }
+
+  const bool ShaderCompiler::ProgramCompleted(uint32_t program) {
+    if (!_parallel) return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+  }
+
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+
+namespace fx {
+
+  // Wraps KHR_parallel_shader_compile (or its ARB twin) when the driver has it. With
+  // it, compiles and links are only issued by the loaders and their results are
+  // checked once the driver reports completion, so many shaders build at once on the
+  // driver's threads instead of one after another on the GL thread. One instance is
+  // shared per context through Context::Shared.
+  class ShaderCompiler {
+    public:
+    ShaderCompiler(const ShaderCompiler&) = default;
+    ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+    ShaderCompiler( );
+    ~ShaderCompiler( );
+
+    // The current context's compiler.
+    static std::shared_ptr<ShaderCompiler> Shared( );
+
+    const bool Parallel( );
+
+    // Never blocks. Always true without parallel compilation, where links finish
+    // before glLinkProgram returns.
+    const bool ProgramCompleted(uint32_t program);
+
+    private:
+    bool _parallel;
+  };
+
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <stdio.h>
@@ -13,6 +14,7 @@
 #include <gl/glew.h>
 #include <gl/glfw3.h>
 
+#include "shadercompiler.h"
 #include "../tools.h"
 #include "../logging.h"
 #include "../content/contentmanager.h"
@@ -25,47 +27,51 @@ namespace fx {
 
 namespace content {
 
-  template<uint32_t T> shared_ptr<fx::ShaderProgram<T>> LoadShader(const LoadOperation& operation) {
-    uint32_t shaderId = glCreateShader(T);
-
-    LOG(DEBUG) << L"Reading shader " << operation.Path << L" ...";
-    string shaderCode;
-    operation.Data->seekg(0, std::ios::end);
-    shaderCode.reserve(operation.Data->tellg( ));
-    operation.Data->seekg(0, std::ios::beg);
-    shaderCode.assign((std::istreambuf_iterator<char>(*operation.Data.get( ))), std::istreambuf_iterator<char>( ));
-    
-    LOG(DEBUG) << L"Compiling shader " << operation.Path << L" ...";
-    char const * shaderSourcePointer = shaderCode.c_str( );
-    glShaderSource(shaderId, 1, &shaderSourcePointer, nullptr);
-    glCompileShader(shaderId);
-
-    GLint result = GL_FALSE;
-    int infoLogLength;
-    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &result);
-    glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-    if (infoLogLength > 0) {
-      auto errorMessage = vector<char>(infoLogLength + 1);
-      glGetShaderInfoLog(shaderId, infoLogLength, NULL, &errorMessage[0]);
-      if (errorMessage[0] != '\0')
-        LOG(ERROR) << &errorMessage[0];
-    }
-
-    if (!result) {
-      glDeleteShader(shaderId);
-      throw EngineException("Failed to compile shader: " + operation.Path, ErrorCode::FX_SHADER_COMPILE_FAILURE);
-    }
-
-    return make_shared<fx::ShaderProgram<T>>(shaderId);
+  template<uint32_t T> function<shared_ptr<fx::ShaderProgram<T>>( )> PrepareShader(const LoadOperation& operation) {
+    auto data = operation.Data;
+    auto path = operation.Path;
+    return [data, path]( ) -> shared_ptr<fx::ShaderProgram<T>> {
+      auto parallel = fx::ShaderCompiler::Shared( )->Parallel( );
+      uint32_t shaderId = glCreateShader(T);
+
+      LOG(DEBUG) << L"Compiling shader " << path << L" ...";
+      char const * shaderSourcePointer = reinterpret_cast<const char*>(data->Data( ));
+      GLint shaderSourceLength = (GLint) data->Size( );
+      glShaderSource(shaderId, 1, &shaderSourcePointer, &shaderSourceLength);
+      glCompileShader(shaderId);
+
+      // Querying the status would wait for the compile; a failure shows up in the link.
+      if (parallel) {
+        return make_shared<fx::ShaderProgram<T>>(shaderId);
+      }
+
+      GLint result = GL_FALSE;
+      int infoLogLength;
+      glGetShaderiv(shaderId, GL_COMPILE_STATUS, &result);
+      glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+      if (infoLogLength > 0) {
+        auto errorMessage = vector<char>(infoLogLength + 1);
+        glGetShaderInfoLog(shaderId, infoLogLength, NULL, &errorMessage[0]);
+        if (errorMessage[0] != '\0')
+          LOG(ERROR) << &errorMessage[0];
+      }
+
+      if (!result) {
+        glDeleteShader(shaderId);
+        throw EngineException("Failed to compile shader: " + path, ErrorCode::FX_SHADER_COMPILE_FAILURE);
+      }
+
+      return make_shared<fx::ShaderProgram<T>>(shaderId);
+    };
   }
 
-  template<> shared_ptr<fx::FragmentShaderProgram> ContentManager::LoadContent<fx::FragmentShaderProgram>(const LoadOperation& operation) {
-    return LoadShader<fx::FragmentShaderProgram::ShaderType>(operation);
+  template<> function<shared_ptr<fx::FragmentShaderProgram>( )> ContentManager::PrepareContent<fx::FragmentShaderProgram>(const LoadOperation& operation) {
+    return PrepareShader<fx::FragmentShaderProgram::ShaderType>(operation);
   }
 
-  template<> shared_ptr<fx::VertexShaderProgram> ContentManager::LoadContent<fx::VertexShaderProgram>(const LoadOperation& operation) {
-    return LoadShader<fx::VertexShaderProgram::ShaderType>(operation);
+  template<> function<shared_ptr<fx::VertexShaderProgram>( )> ContentManager::PrepareContent<fx::VertexShaderProgram>(const LoadOperation& operation) {
+    return PrepareShader<fx::VertexShaderProgram::ShaderType>(operation);
   }
 
   template<> const string ContentManager::ContentExtension<fx::FragmentShaderProgram>( ) {
@@ -76,4 +82,12 @@ namespace content {
     return ".glsl";
   }
 
+  template<> const size_t ContentManager::ContentSize<fx::FragmentShaderProgram>(fx::FragmentShaderProgram& content) {
+    return 0;
+  }
+
+  template<> const size_t ContentManager::ContentSize<fx::VertexShaderProgram>(fx::VertexShaderProgram& content) {
+    return 0;
+  }
+
 }
\ No newline at end of file
@@ -1,76 +1,436 @@
 #include "stdafx.h"
 #include "spritebatch.h"
 
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
 #include <gl/glew.h>
 #include <gl/glfw3.h>
 
+#include "context.h"
+#include "../engineexception.h"
+#include "../radixsort.h"
+
 namespace fx {
 
 # define BUFFER_OFFSET(i) ((char*)nullptr + (i))
 
-  SpriteBatch::SpriteBatch( )
-    : _vao(0)
-    , _vertices(GL_ARRAY_BUFFER)
-    , _indices(GL_ELEMENT_ARRAY_BUFFER) {
+  static const float UnitQuad[ ] = {
+    0.0f, 0.0f,
+    1.0f, 0.0f,
+    0.0f, 1.0f,
+    1.0f, 1.0f
+  };
+
+  SpriteBatch::SpriteBatch(const SpriteBatchOptions& options)
+    : _options(options)
+    , _stride(SpriteVertexStride(options.Format))
+    , _spriteBytes(options.Mode == SpriteBatchMode::Instanced ? sizeof(SpriteInstance) : _stride * 4)
+    , _sortMode(SpriteSortMode::Deferred)
+    , _culling(false)
+    , _pixelScale(0.0f)
+    , _queue(nullptr)
+    , _shader(nullptr)
+    , _layer(0)
+    , _depth(0.0f)
+    , _state(GpuStateCache::Shared( ))
+    , _profiler(GpuProfiler::Shared( ))
+    , _vao(0)
+    , _quad(0)
+    , _vertices(GL_ARRAY_BUFFER, options.BufferSize, options.BufferRegions)
+    , _quadIndices(QuadIndexBuffer::Shared(options.Mode == SpriteBatchMode::Instanced ? 1 : options.MaxSprites))
+    , _wrapsAtReset(0) {
+
+    if (_options.MaxSprites == 0 || ((_options.MaxSprites * _spriteBytes + 63) & ~63u) > _vertices.Capacity( )) {
+      throw EngineException("SpriteBatch MaxSprites does not fit in one region of its buffer.", ErrorCode::FX_BUFFER_OVERFLOW);
+    }
+    ResetStats( );
 
     glGenVertexArrays(1, &_vao);
+
+    if (_options.Mode == SpriteBatchMode::Instanced) {
+      _state->BindVertexArray(_vao);
+
+      glGenBuffers(1, &_quad);
+      glBindBuffer(GL_ARRAY_BUFFER, _quad);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(UnitQuad), UnitQuad, GL_STATIC_DRAW);
+      glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+
+      for (uint32_t attrib = 1; attrib <= 6; ++attrib) {
+        glVertexAttribDivisor(attrib, 1);
+      }
+    }
   }
 
   SpriteBatch::~SpriteBatch( ) {
-    if (_vao != 0) glDeleteVertexArrays(1, &_vao);
+    auto quad = _quad;
+    auto vao = _vao;
+    Context::Release([quad, vao]( ) {
+      if (quad != 0) glDeleteBuffers(1, &quad);
+      if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        GpuStateCache::VertexArrayDeleted(vao);
+      }
+    });
   }
 
-  void SpriteBatch::Begin(math::mat4 matrix) {
+  void SpriteBatch::Begin(math::mat4 matrix, SpriteSortMode sortMode) {
     _matrix = matrix;
-    _verticesSource.clear( );
-    _indicesSource.clear( );
+    _sortMode = sortMode;
+    _queue = nullptr;
+    _shader = nullptr;
+    _pixelScale = 0.0f;
+    _sprites.clear( );
+    _textures.clear( );
+
+    std::lock_guard<std::mutex> lock(_submitLock);
+    _submitted.clear( );
+  }
+
+  void SpriteBatch::Begin(RenderQueue& queue, Shader& shader, math::mat4 matrix, SpriteSortMode sortMode, uint32_t layer, float depth) {
+    Begin(matrix, sortMode);
+    _queue = &queue;
+    _shader = &shader;
+    _layer = layer;
+    _depth = depth;
   }
 
   void SpriteBatch::End( ) {
-    Flush();
+    // Recorded buffers are merged after anything drawn directly, in submission order.
+    std::vector<const SpriteCommandBuffer*> submitted;
+    {
+      std::lock_guard<std::mutex> lock(_submitLock);
+      submitted.swap(_submitted);
+    }
+    for (auto it = submitted.begin( ); it != submitted.end( ); ++it) {
+      Queue((*it)->Sprites( ), (*it)->Textures( ), (*it)->Size( ));
+    }
+
+    Flush( );
+  }
+
+  void SpriteBatch::CullRect(const math::vec4& bounds) {
+    // Stored as (right, top, -left, -bottom) so that one compare against
+    // (left, bottom, -right, -top) of a sprite tests all four edges.
+    _cullRect = math::vec4(bounds[2], bounds[3], -bounds[0], -bounds[1]);
+    _culling = true;
+  }
+
+  void SpriteBatch::CullRect(Camera& camera) {
+    CullRect(camera.Bounds( ));
+  }
+
+  void SpriteBatch::ClearCullRect( ) {
+    _culling = false;
+  }
+
+  void SpriteBatch::Submit(const SpriteCommandBuffer& commands) {
+    std::lock_guard<std::mutex> lock(_submitLock);
+    _submitted.push_back(&commands);
   }
 
   void SpriteBatch::Draw(float x, float y, float z, float w, float h) {
-    index_t i1 = (index_t) _verticesSource.size( ),
-            i2 = i1 + 1, i3 = i2 + 1, i4 = i3 + 1;
+    Queue({ x, y, z, w, h, 0, 0, 0, 0xFFFF, 0xFFFF, 0xFFFFFFFF }, 0);
+  }
+
+  void SpriteBatch::Draw(const SpriteInstance& sprite) {
+    Queue(sprite, 0);
+  }
+
+  void SpriteBatch::Draw(Texture& texture, float x, float y, float z, float w, float h) {
+    SpriteInstance sprite = { x, y, z, w, h, 0, 0, 0, 0xFFFF, 0xFFFF, 0xFFFFFFFF };
+    Queue(sprite, texture.Id( ), texture.Streamed( ) ? &texture : nullptr);
+  }
+
+  void SpriteBatch::Draw(Texture& texture, const SpriteInstance& sprite) {
+    Queue(sprite, texture.Id( ), texture.Streamed( ) ? &texture : nullptr);
+  }
+
+  void SpriteBatch::DrawMany(const SpriteInstance* sprites, size_t count) {
+    Queue(sprites, count, 0);
+  }
+
+  void SpriteBatch::DrawMany(Texture& texture, const SpriteInstance* sprites, size_t count) {
+    Queue(sprites, count, texture.Id( ), texture.Streamed( ) ? &texture : nullptr);
+  }
+
+  void SpriteBatch::Draw(TextureArray& textures, const SpriteInstance& sprite) {
+    Queue(sprite, textures.Id( ) | ArrayTextureKey);
+  }
+
+  void SpriteBatch::DrawMany(TextureArray& textures, const SpriteInstance* sprites, size_t count) {
+    Queue(sprites, count, textures.Id( ) | ArrayTextureKey);
+  }
+
+  void SpriteBatch::Draw(const AtlasRegion& region, float x, float y, float z, float w, float h) {
+    Queue({ x, y, z, w, h, 0, region.U0, region.V0, region.U1, region.V1, 0xFFFFFFFF }, region.TextureId);
+  }
+
+  void SpriteBatch::Draw(const AtlasRegion& region, const SpriteInstance& sprite) {
+    auto placed = sprite;
+    placed.u0 = region.U0;
+    placed.v0 = region.V0;
+    placed.u1 = region.U1;
+    placed.v1 = region.V1;
+    Queue(placed, region.TextureId);
+  }
+
+  void SpriteBatch::Observe(Texture& texture, const SpriteInstance* sprites, size_t count) {
+    // The sprite's UVs may only cover part of the texture, so scale up to the whole.
+    float pixels = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+      auto& sprite = sprites[i];
+      auto uSpan = (sprite.u1 > sprite.u0 ? sprite.u1 - sprite.u0 : sprite.u0 - sprite.u1) / 65535.0f;
+      auto vSpan = (sprite.v1 > sprite.v0 ? sprite.v1 - sprite.v0 : sprite.v0 - sprite.v1) / 65535.0f;
+      if (uSpan > 0.0f) pixels = std::max(pixels, sprite.w / uSpan);
+      if (vSpan > 0.0f) pixels = std::max(pixels, sprite.h / vSpan);
+    }
+
+    // Pixels per world unit along x, worked out on the first streamed draw of a batch.
+    // The viewport is assumed to cover the framebuffer, whose size the context tracks
+    // without asking GL.
+    if (_pixelScale == 0.0f) {
+      _pixelScale = fabsf(_matrix(0, 0)) * Context::Current( )->FramebufferWidth( ) * 0.5f;
+    }
+    texture.Observe(pixels * _pixelScale);
+  }
+
+  void SpriteBatch::Queue(const SpriteInstance& sprite, uint32_t texture, Texture* streamed) {
+    if (_culling && Culled(sprite)) return;
+    if (streamed) Observe(*streamed, &sprite, 1);
 
-    _verticesSource.push_back({ x + 0, y + 0, z, 0, 0 });
-    _verticesSource.push_back({ x + w, y + 0, z, 1, 0 });
-    _verticesSource.push_back({ x + w, y + h, z, 1, 1 });
-    _verticesSource.push_back({ x + 0, y + h, z, 0, 1 });
+    _sprites.push_back(sprite);
+    _textures.push_back(texture);
 
-    _indicesSource.push_back(i1);
-    _indicesSource.push_back(i3);
-    _indicesSource.push_back(i4);
+    if (FlushDue( )) {
+      Flush( );
+    }
+  }
+
+  void SpriteBatch::Queue(const SpriteInstance* sprites, size_t count, uint32_t texture, Texture* streamed) {
+    const auto first = _sprites.size( );
+    if (_culling) {
+      for (size_t i = 0; i < count; ++i) {
+        if (Culled(sprites[i])) continue;
+        _sprites.push_back(sprites[i]);
+        _textures.push_back(texture);
+      }
+    } else {
+      _sprites.insert(_sprites.end( ), sprites, sprites + count);
+      _textures.insert(_textures.end( ), count, texture);
+    }
+
+    // Only what survived culling is on screen.
+    if (streamed && _sprites.size( ) > first) {
+      Observe(*streamed, &_sprites[first], _sprites.size( ) - first);
+    }
+
+    if (FlushDue( )) {
+      Flush( );
+    }
+  }
+
+  void SpriteBatch::Queue(const SpriteInstance* sprites, const uint32_t* textures, size_t count) {
+    if (_culling) {
+      for (size_t i = 0; i < count; ++i) {
+        if (Culled(sprites[i])) continue;
+        _sprites.push_back(sprites[i]);
+        _textures.push_back(textures[i]);
+      }
+    } else {
+      _sprites.insert(_sprites.end( ), sprites, sprites + count);
+      _textures.insert(_textures.end( ), textures, textures + count);
+    }
+
+    if (FlushDue( )) {
+      Flush( );
+    }
+  }
+
+  bool SpriteBatch::Culled(const SpriteInstance& sprite) {
+    using namespace math::simd;
+
+    simd4f box;
+    if (sprite.rotation != 0.0f) {
+      // Any rotation stays within the circle through the corners.
+      const auto cx = sprite.x + sprite.w * 0.5f;
+      const auto cy = sprite.y + sprite.h * 0.5f;
+      const auto r = 0.5f * sqrtf(sprite.w * sprite.w + sprite.h * sprite.h);
+      box = simd4f_create(cx - r, cy - r, -(cx + r), -(cy + r));
+    } else {
+      box = simd4f_create(
+        fminf(sprite.x, sprite.x + sprite.w), fminf(sprite.y, sprite.y + sprite.h),
+        -fmaxf(sprite.x, sprite.x + sprite.w), -fmaxf(sprite.y, sprite.y + sprite.h));
+    }
+
+    if (simd4f_getsigns(simd4f_cmp_lt(simd4f_uload4(_cullRect( )), box)) == 0) return false;
+    _stats.Culled++;
+    return true;
+  }
+
+  bool SpriteBatch::FlushDue( ) {
+    // Sorted modes need every sprite before anything can be drawn.
+    if (_sortMode != SpriteSortMode::Deferred) return false;
+
+    switch (_options.FlushPolicy) {
+    case SpriteFlushPolicy::Count: return _sprites.size( ) >= _options.MaxSprites;
+    case SpriteFlushPolicy::Bytes: return _sprites.size( ) * _spriteBytes >= _options.FlushBytes;
+    default: return false;
+    }
+  }
+
+  void SpriteBatch::Flush( ) {
+    const auto count = (uint32_t) _sprites.size( );
+    if (count == 0) return;
 
-    _indicesSource.push_back(i1);
-    _indicesSource.push_back(i2);
-    _indicesSource.push_back(i3);
+    if (_options.Mode == SpriteBatchMode::Vertices && _options.Format == SpriteVertexFormat::Packed) {
+      for (uint32_t i = 0; i < count; ++i) {
+        if (PackableDepth(_sprites[i].z)) continue;
 
-    if (_verticesSource.size( ) >= 1024) {
-      Flush();
+        _sprites.clear( );
+        _textures.clear( );
+        throw EngineException("Packed sprite vertices only hold whole z values within +/-32767.", ErrorCode::FX_INVALID_SPRITE);
+      }
+    }
+
+    GpuProfileScope scope(*_profiler, "SpriteBatch::Flush");
+
+    // The sort key lives in the high half and the submission index in the low half,
+    // so the sort is stable and the index is recovered from the sorted keys.
+    _keys.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      uint64_t key = 0;
+      switch (_sortMode) {
+      case SpriteSortMode::Texture: key = _textures[i]; break;
+      case SpriteSortMode::BackToFront: key = ~radix_float_key(_sprites[i].z); break;
+      case SpriteSortMode::FrontToBack: key = radix_float_key(_sprites[i].z); break;
+      default: break;
+      }
+      _keys[i] = (key << 32) | i;
+    }
+    if (_sortMode != SpriteSortMode::Deferred) {
+      radix_sort(_keys, _scratch, 4);
+    }
+
+    uint32_t first = 0;
+    while (first < count) {
+      const auto texture = _textures[(uint32_t) _keys[first]];
+      auto last = first + 1;
+      while (last < count && last - first < _options.MaxSprites && _textures[(uint32_t) _keys[last]] == texture) {
+        ++last;
+      }
+
+      if (_queue) {
+        // The queue binds the texture itself, and the run may be drawn after this batch
+        // has moved on, so it gets its own copy of the sprites.
+        auto run = std::make_shared<std::vector<SpriteInstance>>( );
+        run->reserve(last - first);
+        for (auto i = first; i < last; ++i) {
+          run->push_back(_sprites[(uint32_t) _keys[i]]);
+        }
+        _queue->Submit(*_shader, texture, _layer, _depth, [this, run]( ) {
+          Emit((uint32_t) run->size( ), [&run](uint32_t i) -> const SpriteInstance& { return (*run)[i]; });
+        });
+      } else {
+        if (texture & ArrayTextureKey) {
+          _state->BindTexture(GL_TEXTURE_2D_ARRAY, texture & ~ArrayTextureKey);
+        } else if (texture != 0) {
+          _state->BindTexture(GL_TEXTURE_2D, texture);
+        }
+        Emit(last - first, [this, first](uint32_t i) -> const SpriteInstance& { return _sprites[(uint32_t) _keys[first + i]]; });
+      }
+      first = last;
+    }
+
+    _sprites.clear( );
+    _textures.clear( );
+  }
+
+  template<typename S> void SpriteBatch::Emit(uint32_t count, const S& sprite) {
+    uint32_t offset;
+
+    _stats.Flushes++;
+    _stats.Sprites += count;
+    _stats.Bytes += count * _spriteBytes;
+
+    if (_options.Mode == SpriteBatchMode::Instanced) {
+      auto instances = _vertices.Reserve<SpriteInstance>(count, offset);
+      for (uint32_t i = 0; i < count; ++i) {
+        instances[i] = sprite(i);
+      }
+      _vertices.Commit( );
+      DrawInstances(offset, count);
+    } else {
+      auto vertices = _vertices.Reserve<uint8_t>(count * 4 * _stride, offset);
+      switch (_options.Format) {
+      case SpriteVertexFormat::Compact: Expand<CompactSpriteVertex>(count, sprite, vertices); break;
+      case SpriteVertexFormat::Packed: Expand<PackedSpriteVertex>(count, sprite, vertices); break;
+      default: Expand<SpriteVertex>(count, sprite, vertices); break;
+      }
+      _vertices.Commit( );
+      DrawVertices(offset, count);
+    }
+  }
+
+  const SpriteBatchStats& SpriteBatch::Stats( ) {
+    _stats.Wraps = _vertices.Wraps( ) - _wrapsAtReset;
+    return _stats;
+  }
+
+  void SpriteBatch::ResetStats( ) {
+    _stats.Flushes = 0;
+    _stats.Sprites = 0;
+    _stats.Culled = 0;
+    _stats.Bytes = 0;
+    _stats.Wraps = 0;
+    _wrapsAtReset = _vertices.Wraps( );
+  }
+
+  template<typename T, typename S> void SpriteBatch::Expand(uint32_t count, const S& sprite, void* destination) {
+    auto vertices = reinterpret_cast<T*>(destination);
+    for (uint32_t i = 0; i < count; ++i) {
+      ExpandSprite(sprite(i), &vertices[i * 4]);
     }
   }
 
-  void SpriteBatch::Flush() {
-    if (_verticesSource.size( ) != 0) {
-      glBindVertexArray(_vao);
+  void SpriteBatch::DrawVertices(uint32_t voffset, uint32_t quads) {
+    _state->BindVertexArray(_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertices.Vbo( ));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _quadIndices->Ibo( ));
+
+    SpriteVertexAttribs(_options.Format, voffset);
+    glEnableVertexArrayAttrib(_vao, 0);
+    glEnableVertexArrayAttrib(_vao, 1);
+    glEnableVertexArrayAttrib(_vao, 2);
+    glEnableVertexArrayAttrib(_vao, 3);
 
-      auto voffset = _vertices.Stream<SpriteVertex>(_verticesSource[0], (index_t) _verticesSource.size( ));
-      auto ioffset = _indices.Stream<index_t>(_indicesSource[0], (index_t) _indicesSource.size( ));
+    glDrawElements(GL_TRIANGLES, quads * 6, _quadIndices->IndexType( ), BUFFER_OFFSET(0));
 
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), BUFFER_OFFSET(voffset));
-      glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), BUFFER_OFFSET(voffset + 12));
-      glEnableVertexArrayAttrib(_vao, 0);
-      glEnableVertexArrayAttrib(_vao, 1);
+    glDisableVertexArrayAttrib(_vao, 0);
+    glDisableVertexArrayAttrib(_vao, 1);
+    glDisableVertexArrayAttrib(_vao, 2);
+    glDisableVertexArrayAttrib(_vao, 3);
+  }
+
+  void SpriteBatch::DrawInstances(uint32_t offset, uint32_t count) {
+    _state->BindVertexArray(_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertices.Vbo( ));
 
-      glDrawElements(GL_TRIANGLES, (index_t) _indicesSource.size( ), GL_UNSIGNED_INT, BUFFER_OFFSET(ioffset));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), BUFFER_OFFSET(offset));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + 12));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + 20));
+    glVertexAttribPointer(4, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + 24));
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + 32));
+    glVertexAttribPointer(6, 1, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + 36));
+    for (uint32_t attrib = 0; attrib <= 6; ++attrib) {
+      glEnableVertexArrayAttrib(_vao, attrib);
+    }
 
-      glDisableVertexArrayAttrib(_vao, 0);
-      glDisableVertexArrayAttrib(_vao, 1);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
 
-      _verticesSource.clear( );
-      _indicesSource.clear( );
+    for (uint32_t attrib = 0; attrib <= 6; ++attrib) {
+      glDisableVertexArrayAttrib(_vao, attrib);
     }
   }
 
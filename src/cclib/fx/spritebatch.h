@@ -1,19 +1,33 @@
 #pragma once
+#include <memory>
+#include <mutex>
 #include <stdint.h>
 #include <vector>
 
+#include "camera.h"
+#include "gpuprofiler.h"
+#include "gpustatecache.h"
+#include "quadindexbuffer.h"
+#include "renderqueue.h"
+#include "shader.h"
+#include "spritebatchoptions.h"
+#include "spritecommandbuffer.h"
+#include "spritevertex.h"
 #include "streamingbufferobject.h"
+#include "texture.h"
 #include "../math.h"
 
 namespace fx {
 
-  struct SpriteVertex {
-
-    float x, y, z;
-    float u, v;
-
-    uint8_t reserved[12];
-
+  enum class SpriteSortMode {
+    // Draw in submission order, flushing whenever the texture changes.
+    Deferred,
+    // Group sprites by texture; submission order is kept within a texture.
+    Texture,
+    // Highest z first.
+    BackToFront,
+    // Lowest z first.
+    FrontToBack
   };
 
   class SpriteBatch {
@@ -23,25 +37,87 @@ namespace fx {
     SpriteBatch(const SpriteBatch&) = default;
     SpriteBatch& operator=(const SpriteBatch&) = delete;
 
-    SpriteBatch( );
+    SpriteBatch(const SpriteBatchOptions& options = SpriteBatchOptions( ));
     ~SpriteBatch( );
 
-    void Begin(math::mat4 matrix);
+    // The matrix must be the one the sprites are drawn with, normally the shader's MVP;
+    // the batch does not apply it, but uses it to work out how many pixels a streamed
+    // texture covers on screen.
+    void Begin(math::mat4 matrix, SpriteSortMode sortMode = SpriteSortMode::Deferred);
+    // Instead of drawing, each flushed run of sprites becomes a packet in the queue that
+    // draws with the shader. The sprites are copied, but the batch itself must outlive
+    // the queue's next Execute.
+    void Begin(RenderQueue& queue, Shader& shader, math::mat4 matrix, SpriteSortMode sortMode = SpriteSortMode::Deferred, uint32_t layer = 0, float depth = 0.0f);
     void End( );
+    void Flush( );
+
+    // Sprites entirely outside the rectangle, given as (left, bottom, right, top),
+    // are dropped by Draw, DrawMany and Submit before they reach the vertex stream.
+    void CullRect(const math::vec4& bounds);
+    void CullRect(Camera& camera);
+    void ClearCullRect( );
 
     void Draw(float x, float y, float z, float w, float h);
+    void Draw(const SpriteInstance& sprite);
+    void Draw(Texture& texture, float x, float y, float z, float w, float h);
+    void Draw(Texture& texture, const SpriteInstance& sprite);
+    void DrawMany(const SpriteInstance* sprites, size_t count);
+    void DrawMany(Texture& texture, const SpriteInstance* sprites, size_t count);
+    void Draw(TextureArray& textures, const SpriteInstance& sprite);
+    void DrawMany(TextureArray& textures, const SpriteInstance* sprites, size_t count);
 
-    private:
-    math::mat4 _matrix;
+    // Draws an atlas region; the sprite's UVs are replaced by the region's.
+    void Draw(const AtlasRegion& region, float x, float y, float z, float w, float h);
+    void Draw(const AtlasRegion& region, const SpriteInstance& sprite);
 
-    uint32_t _vao;
-    StreamingBufferObject _vertices;
-    StreamingBufferObject _indices;
+    // May be called from any thread between Begin and End. The buffer is read on the
+    // GL thread during End, so it must stay alive and unchanged until End returns.
+    void Submit(const SpriteCommandBuffer& commands);
 
-    std::vector<SpriteVertex> _verticesSource;
-    std::vector<index_t> _indicesSource;
+    const SpriteBatchStats& Stats( );
+    void ResetStats( );
 
-    void Flush();
+    private:
+    const SpriteBatchOptions _options;
+    const uint32_t _stride, _spriteBytes;
+    math::mat4 _matrix;
+    SpriteSortMode _sortMode;
+    bool _culling;
+    math::vec4 _cullRect;
+    float _pixelScale;
+
+    RenderQueue* _queue;
+    Shader* _shader;
+    uint32_t _layer;
+    float _depth;
+
+    std::shared_ptr<GpuStateCache> _state;
+    std::shared_ptr<GpuProfiler> _profiler;
+    uint32_t _vao, _quad;
+    StreamingBufferObject _vertices;
+    std::shared_ptr<QuadIndexBuffer> _quadIndices;
+
+    std::vector<SpriteInstance> _sprites;
+    std::vector<uint32_t> _textures;
+    std::vector<uint64_t> _keys, _scratch;
+
+    std::mutex _submitLock;
+    std::vector<const SpriteCommandBuffer*> _submitted;
+
+    SpriteBatchStats _stats;
+    uint32_t _wrapsAtReset;
+
+    // Streamed textures are told about the sprites that survive culling.
+    void Queue(const SpriteInstance& sprite, uint32_t texture, Texture* streamed = nullptr);
+    void Queue(const SpriteInstance* sprites, size_t count, uint32_t texture, Texture* streamed = nullptr);
+    void Queue(const SpriteInstance* sprites, const uint32_t* textures, size_t count);
+    bool Culled(const SpriteInstance& sprite);
+    void Observe(Texture& texture, const SpriteInstance* sprites, size_t count);
+    bool FlushDue( );
+    template<typename S> void Emit(uint32_t count, const S& sprite);
+    template<typename T, typename S> void Expand(uint32_t count, const S& sprite, void* destination);
+    void DrawVertices(uint32_t offset, uint32_t quads);
+    void DrawInstances(uint32_t offset, uint32_t count);
   };
 
 }
\ No newline at end of file
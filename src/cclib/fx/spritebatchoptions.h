@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+
+#include "spritevertex.h"
+
+namespace fx {
+
+  enum class SpriteBatchMode {
+    Vertices,
+    Instanced
+  };
+
+  // When queued sprites are submitted before End. Only applies to deferred batches;
+  // sorted batches always wait for End or an explicit Flush.
+  enum class SpriteFlushPolicy {
+    // Once MaxSprites sprites are queued.
+    Count,
+    // Once the queued sprites would take FlushBytes of buffer space.
+    Bytes,
+    // Only on End or Flush.
+    Explicit
+  };
+
+  struct SpriteBatchOptions {
+    SpriteBatchMode Mode;
+    SpriteVertexFormat Format;
+    SpriteFlushPolicy FlushPolicy;
+
+    uint32_t MaxSprites;
+    uint32_t FlushBytes;
+
+    uint32_t BufferSize;
+    uint32_t BufferRegions;
+
+    SpriteBatchOptions(const SpriteBatchOptions&) = default;
+    SpriteBatchOptions& operator=(const SpriteBatchOptions&) = delete;
+
+    SpriteBatchOptions(SpriteBatchMode mode = SpriteBatchMode::Vertices, SpriteVertexFormat format = SpriteVertexFormat::Float)
+      : Mode(mode)
+      , Format(format) {
+
+      FlushPolicy = SpriteFlushPolicy::Count;
+      MaxSprites = 4096;
+      FlushBytes = 0x80000;
+
+      BufferSize = 0x200000;
+      BufferRegions = 3;
+    }
+
+  };
+
+  struct SpriteBatchStats {
+    uint64_t Flushes;
+    uint64_t Sprites;
+    uint64_t Culled;
+    uint64_t Bytes;
+    uint64_t Wraps;
+  };
+
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "stdafx.h"
+#include "spritecommandbuffer.h"
+
+namespace fx {
+
+  SpriteCommandBuffer::SpriteCommandBuffer( ) {
+  }
+
+  SpriteCommandBuffer::~SpriteCommandBuffer( ) {
+  }
+
+  void SpriteCommandBuffer::Clear( ) {
+    _sprites.clear( );
+    _textures.clear( );
+  }
+
+  void SpriteCommandBuffer::Reserve(size_t count) {
+    _sprites.reserve(count);
+    _textures.reserve(count);
+  }
+
+  const size_t SpriteCommandBuffer::Size( ) const {
+    return _sprites.size( );
+  }
+
+  void SpriteCommandBuffer::Draw(float x, float y, float z, float w, float h) {
+    Draw({ x, y, z, w, h, 0, 0, 0, 0xFFFF, 0xFFFF, 0xFFFFFFFF });
+  }
+
+  void SpriteCommandBuffer::Draw(const SpriteInstance& sprite) {
+    _sprites.push_back(sprite);
+    _textures.push_back(0);
+  }
+
+  void SpriteCommandBuffer::Draw(Texture& texture, float x, float y, float z, float w, float h) {
+    Draw(texture, { x, y, z, w, h, 0, 0, 0, 0xFFFF, 0xFFFF, 0xFFFFFFFF });
+  }
+
+  void SpriteCommandBuffer::Draw(Texture& texture, const SpriteInstance& sprite) {
+    _sprites.push_back(sprite);
+    _textures.push_back(texture.Id( ));
+  }
+
+  void SpriteCommandBuffer::DrawMany(const SpriteInstance* sprites, size_t count) {
+    _sprites.insert(_sprites.end( ), sprites, sprites + count);
+    _textures.insert(_textures.end( ), count, 0);
+  }
+
+  void SpriteCommandBuffer::DrawMany(Texture& texture, const SpriteInstance* sprites, size_t count) {
+    _sprites.insert(_sprites.end( ), sprites, sprites + count);
+    _textures.insert(_textures.end( ), count, texture.Id( ));
+  }
+
+  void SpriteCommandBuffer::Draw(TextureArray& textures, const SpriteInstance& sprite) {
+    _sprites.push_back(sprite);
+    _textures.push_back(textures.Id( ) | ArrayTextureKey);
+  }
+
+  void SpriteCommandBuffer::DrawMany(TextureArray& textures, const SpriteInstance* sprites, size_t count) {
+    _sprites.insert(_sprites.end( ), sprites, sprites + count);
+    _textures.insert(_textures.end( ), count, textures.Id( ) | ArrayTextureKey);
+  }
+
+  void SpriteCommandBuffer::Draw(const AtlasRegion& region, float x, float y, float z, float w, float h) {
+    _sprites.push_back({ x, y, z, w, h, 0, region.U0, region.V0, region.U1, region.V1, 0xFFFFFFFF });
+    _textures.push_back(region.TextureId);
+  }
+
+  void SpriteCommandBuffer::Draw(const AtlasRegion& region, const SpriteInstance& sprite) {
+    _sprites.push_back(sprite);
+    auto& placed = _sprites.back( );
+    placed.u0 = region.U0;
+    placed.v0 = region.V0;
+    placed.u1 = region.U1;
+    placed.v1 = region.V1;
+    _textures.push_back(region.TextureId);
+  }
+
+  const SpriteInstance* SpriteCommandBuffer::Sprites( ) const {
+    return _sprites.data( );
+  }
+
+  const uint32_t* SpriteCommandBuffer::Textures( ) const {
+    return _textures.data( );
+  }
+
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "texture.h"
+#include "textureatlas.h"
+#include "texturearray.h"
+
+namespace fx {
+
+  // A single sprite as consumed by the instanced path. UVs are 16-bit normalized
+  // and the color is RGBA8 in memory order (red in the lowest byte). The layer
+  // selects the image when drawing from a TextureArray.
+  struct SpriteInstance {
+
+    float x, y, z;
+    float w, h;
+    float rotation;
+
+    uint16_t u0, v0, u1, v1;
+    uint32_t color;
+    uint16_t layer;
+    uint16_t reserved;
+
+  };
+
+  // Sprites record the GL texture id they are drawn with. Array textures carry this
+  // bit so that they are bound to GL_TEXTURE_2D_ARRAY instead of GL_TEXTURE_2D.
+  static const uint32_t ArrayTextureKey = 0x80000000;
+
+  // Records sprites without touching GL so that it can be filled from any thread.
+  // Give each worker its own buffer and hand it to SpriteBatch::Submit; the batch
+  // merges it on the GL thread in End.
+  class SpriteCommandBuffer {
+    public:
+    SpriteCommandBuffer(const SpriteCommandBuffer&) = default;
+    SpriteCommandBuffer& operator=(const SpriteCommandBuffer&) = delete;
+
+    SpriteCommandBuffer( );
+    ~SpriteCommandBuffer( );
+
+    void Clear( );
+    void Reserve(size_t count);
+    const size_t Size( ) const;
+
+    void Draw(float x, float y, float z, float w, float h);
+    void Draw(const SpriteInstance& sprite);
+    void Draw(Texture& texture, float x, float y, float z, float w, float h);
+    void Draw(Texture& texture, const SpriteInstance& sprite);
+    void DrawMany(const SpriteInstance* sprites, size_t count);
+    void DrawMany(Texture& texture, const SpriteInstance* sprites, size_t count);
+    void Draw(TextureArray& textures, const SpriteInstance& sprite);
+    void DrawMany(TextureArray& textures, const SpriteInstance* sprites, size_t count);
+
+    // Draws an atlas region; the sprite's UVs are replaced by the region's.
+    void Draw(const AtlasRegion& region, float x, float y, float z, float w, float h);
+    void Draw(const AtlasRegion& region, const SpriteInstance& sprite);
+
+    const SpriteInstance* Sprites( ) const;
+    const uint32_t* Textures( ) const;
+
+    private:
+    std::vector<SpriteInstance> _sprites;
+    std::vector<uint32_t> _textures;
+  };
+
+}
\ No newline at end of file
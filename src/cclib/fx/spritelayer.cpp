@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "spritelayer.h"
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+# define BUFFER_OFFSET(i) ((char*)nullptr + (i))
+
+  SpriteLayer::SpriteLayer(const SpriteInstance* sprites, uint32_t count, SpriteVertexFormat format)
+    : _format(format)
+    , _stride(SpriteVertexStride(format))
+    , _count(count)
+    , _texture(0)
+    , _transform(math::mat_identity<4, 4>( ))
+    , _state(GpuStateCache::Shared( ))
+    , _vao(0)
+    , _vbo(0)
+    , _quadIndices(QuadIndexBuffer::Shared(count)) {
+    Upload(sprites);
+  }
+
+  SpriteLayer::SpriteLayer(Texture& texture, const SpriteInstance* sprites, uint32_t count, SpriteVertexFormat format)
+    : _format(format)
+    , _stride(SpriteVertexStride(format))
+    , _count(count)
+    , _texture(texture.Id( ))
+    , _transform(math::mat_identity<4, 4>( ))
+    , _state(GpuStateCache::Shared( ))
+    , _vao(0)
+    , _vbo(0)
+    , _quadIndices(QuadIndexBuffer::Shared(count)) {
+    Upload(sprites);
+  }
+
+  SpriteLayer::~SpriteLayer( ) {
+    auto vbo = _vbo;
+    auto vao = _vao;
+    Context::Release([vbo, vao]( ) {
+      if (vbo != 0) glDeleteBuffers(1, &vbo);
+      if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        GpuStateCache::VertexArrayDeleted(vao);
+      }
+    });
+  }
+
+  const uint32_t SpriteLayer::Count( ) {
+    return _count;
+  }
+
+  math::mat4& SpriteLayer::Transform( ) {
+    return _transform;
+  }
+
+  void SpriteLayer::Upload(const SpriteInstance* sprites) {
+    if (_count == 0) return;
+
+    std::vector<uint8_t> vertices;
+    Expand(sprites, _count, vertices);
+
+    glGenVertexArrays(1, &_vao);
+    _state->BindVertexArray(_vao);
+
+    glGenBuffers(1, &_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    if (GLEW_ARB_buffer_storage || GLEW_VERSION_4_4) {
+      // Immutable storage; only glBufferSubData may change it.
+      glBufferStorage(GL_ARRAY_BUFFER, vertices.size( ), &vertices[0], GL_DYNAMIC_STORAGE_BIT);
+    } else {
+      glBufferData(GL_ARRAY_BUFFER, vertices.size( ), &vertices[0], GL_STATIC_DRAW);
+    }
+
+    // The buffer never moves, so the attributes are set up once.
+    SpriteVertexAttribs(_format, 0);
+    glEnableVertexArrayAttrib(_vao, 0);
+    glEnableVertexArrayAttrib(_vao, 1);
+    glEnableVertexArrayAttrib(_vao, 2);
+    glEnableVertexArrayAttrib(_vao, 3);
+
+    _state->BindVertexArray(0);
+  }
+
+  void SpriteLayer::Update(uint32_t first, const SpriteInstance* sprites, uint32_t count) {
+    if (first > _count || count > _count - first) {
+      throw EngineException("Sprite layer update is out of range.", ErrorCode::FX_BUFFER_OVERFLOW);
+    }
+    if (count == 0) return;
+
+    std::vector<uint8_t> vertices;
+    Expand(sprites, count, vertices);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, first * 4 * _stride, vertices.size( ), &vertices[0]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  void SpriteLayer::Draw(Shader& shader, const math::mat4& viewProjection) {
+    if (_count == 0) return;
+
+    shader.Uniform(shader.Uniform("MVP"), viewProjection * _transform);
+
+    if (_texture != 0) {
+      _state->BindTexture(GL_TEXTURE_2D, _texture);
+    }
+
+    // The shared index buffer may have been regrown since the last draw.
+    _state->BindVertexArray(_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _quadIndices->Ibo( ));
+    glDrawElements(GL_TRIANGLES, _count * 6, _quadIndices->IndexType( ), BUFFER_OFFSET(0));
+  }
+
+  void SpriteLayer::Expand(const SpriteInstance* sprites, uint32_t count, std::vector<uint8_t>& destination) {
+    if (_format == SpriteVertexFormat::Packed) {
+      for (uint32_t i = 0; i < count; ++i) {
+        if (!PackableDepth(sprites[i].z)) {
+          throw EngineException("Packed sprite vertices only hold whole z values within +/-32767.", ErrorCode::FX_INVALID_SPRITE);
+        }
+      }
+    }
+
+    destination.resize(count * 4 * _stride);
+    for (uint32_t i = 0; i < count; ++i) {
+      auto vertices = &destination[i * 4 * _stride];
+      switch (_format) {
+      case SpriteVertexFormat::Compact: ExpandSprite(sprites[i], reinterpret_cast<CompactSpriteVertex*>(vertices)); break;
+      case SpriteVertexFormat::Packed: ExpandSprite(sprites[i], reinterpret_cast<PackedSpriteVertex*>(vertices)); break;
+      default: ExpandSprite(sprites[i], reinterpret_cast<SpriteVertex*>(vertices)); break;
+      }
+    }
+  }
+
+}
\ No newline at end of file
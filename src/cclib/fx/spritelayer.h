@@ -0,0 +1,51 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "gpustatecache.h"
+#include "quadindexbuffer.h"
+#include "shader.h"
+#include "spritevertex.h"
+#include "texture.h"
+#include "../math.h"
+
+namespace fx {
+
+  // Sprites that rarely change, such as backgrounds and tile layers. They are
+  // expanded and uploaded once into an immutable buffer and drawn with one call.
+  // With the Packed format, construction and Update throw FX_INVALID_SPRITE for a
+  // sprite whose z is not a whole number within +/-32767.
+  class SpriteLayer {
+    public:
+    SpriteLayer(const SpriteLayer&) = default;
+    SpriteLayer& operator=(const SpriteLayer&) = delete;
+
+    SpriteLayer(const SpriteInstance* sprites, uint32_t count, SpriteVertexFormat format = SpriteVertexFormat::Float);
+    SpriteLayer(Texture& texture, const SpriteInstance* sprites, uint32_t count, SpriteVertexFormat format = SpriteVertexFormat::Float);
+    ~SpriteLayer( );
+
+    const uint32_t Count( );
+    math::mat4& Transform( );
+
+    // Replaces sprites [first, first + count) and re-uploads only that range.
+    void Update(uint32_t first, const SpriteInstance* sprites, uint32_t count);
+
+    // Sets the shader's MVP uniform to viewProjection * Transform( ) and draws the
+    // layer. The shader must already be applied.
+    void Draw(Shader& shader, const math::mat4& viewProjection);
+
+    private:
+    const SpriteVertexFormat _format;
+    const uint32_t _stride, _count, _texture;
+    math::mat4 _transform;
+
+    std::shared_ptr<GpuStateCache> _state;
+    uint32_t _vao, _vbo;
+    std::shared_ptr<QuadIndexBuffer> _quadIndices;
+
+    void Upload(const SpriteInstance* sprites);
+    void Expand(const SpriteInstance* sprites, uint32_t count, std::vector<uint8_t>& destination);
+  };
+
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "stdafx.h"
+#include "spritevertex.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "../math.h"
+
+namespace fx {
+
+# define BUFFER_OFFSET(i) ((char*)nullptr + (i))
+
+  uint32_t SpriteVertexStride(SpriteVertexFormat format) {
+    switch (format) {
+    case SpriteVertexFormat::Compact: return sizeof(CompactSpriteVertex);
+    case SpriteVertexFormat::Packed: return sizeof(PackedSpriteVertex);
+    default: return sizeof(SpriteVertex);
+    }
+  }
+
+  bool PackableDepth(float z) {
+    return z == floorf(z) && z >= -32768.0f && z <= 32767.0f;
+  }
+
+  static int16_t PackPosition(float value) {
+    // Saturate first; casting an out of range float is undefined.
+    return (int16_t) std::max(-32768.0f, std::min(32767.0f, floorf(value + 0.5f)));
+  }
+
+  static void WriteVertex(SpriteVertex& vertex, float x, float y, float z, uint16_t u, uint16_t v, uint32_t color, uint16_t layer) {
+    vertex.x = x;
+    vertex.y = y;
+    vertex.z = z;
+    vertex.u = u / 65535.0f;
+    vertex.v = v / 65535.0f;
+    vertex.color = color;
+    vertex.layer = layer;
+  }
+
+  static void WriteVertex(CompactSpriteVertex& vertex, float x, float y, float z, uint16_t u, uint16_t v, uint32_t color, uint16_t layer) {
+    vertex.x = x;
+    vertex.y = y;
+    vertex.z = z;
+    vertex.u = u;
+    vertex.v = v;
+    vertex.color = color;
+    vertex.layer = layer;
+    vertex.reserved = 0;
+  }
+
+  static void WriteVertex(PackedSpriteVertex& vertex, float x, float y, float z, uint16_t u, uint16_t v, uint32_t color, uint16_t layer) {
+    vertex.x = PackPosition(x);
+    vertex.y = PackPosition(y);
+    vertex.z = PackPosition(z);
+    vertex.u = u;
+    vertex.v = v;
+    vertex.color = color;
+    vertex.layer = layer;
+  }
+
+  // Rotates around the center of the sprite, matching vertex_instanced.glsl. The four
+  // corners are computed together, one per SIMD lane.
+  template<typename T> void ExpandSprite(const SpriteInstance& sprite, T* vertices) {
+    using namespace math::simd;
+
+    const simd4f dx = simd4f_mul(simd4f_create(-0.5f, 0.5f, 0.5f, -0.5f), simd4f_splat(sprite.w));
+    const simd4f dy = simd4f_mul(simd4f_create(-0.5f, -0.5f, 0.5f, 0.5f), simd4f_splat(sprite.h));
+    const simd4f cx = simd4f_splat(sprite.x + sprite.w * 0.5f);
+    const simd4f cy = simd4f_splat(sprite.y + sprite.h * 0.5f);
+
+    simd4f xs, ys;
+    if (sprite.rotation != 0.0f) {
+      const simd4f c = simd4f_splat(cosf(sprite.rotation));
+      const simd4f s = simd4f_splat(sinf(sprite.rotation));
+      xs = simd4f_sub(simd4f_madd(dx, c, cx), simd4f_mul(dy, s));
+      ys = simd4f_madd(dy, c, simd4f_madd(dx, s, cy));
+    } else {
+      xs = simd4f_add(cx, dx);
+      ys = simd4f_add(cy, dy);
+    }
+
+    cclib_aligned(16) float x[4];
+    cclib_aligned(16) float y[4];
+    simd4f_ustore4(xs, x);
+    simd4f_ustore4(ys, y);
+
+    WriteVertex(vertices[0], x[0], y[0], sprite.z, sprite.u0, sprite.v0, sprite.color, sprite.layer);
+    WriteVertex(vertices[1], x[1], y[1], sprite.z, sprite.u1, sprite.v0, sprite.color, sprite.layer);
+    WriteVertex(vertices[2], x[2], y[2], sprite.z, sprite.u1, sprite.v1, sprite.color, sprite.layer);
+    WriteVertex(vertices[3], x[3], y[3], sprite.z, sprite.u0, sprite.v1, sprite.color, sprite.layer);
+  }
+
+  template void ExpandSprite<SpriteVertex>(const SpriteInstance& sprite, SpriteVertex* vertices);
+  template void ExpandSprite<CompactSpriteVertex>(const SpriteInstance& sprite, CompactSpriteVertex* vertices);
+  template void ExpandSprite<PackedSpriteVertex>(const SpriteInstance& sprite, PackedSpriteVertex* vertices);
+
+  void SpriteVertexAttribs(SpriteVertexFormat format, uint32_t offset) {
+    const auto stride = SpriteVertexStride(format);
+    switch (format) {
+    case SpriteVertexFormat::Compact:
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(offset));
+      glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, BUFFER_OFFSET(offset + 12));
+      glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, BUFFER_OFFSET(offset + 16));
+      glVertexAttribPointer(3, 1, GL_UNSIGNED_SHORT, GL_FALSE, stride, BUFFER_OFFSET(offset + 20));
+      break;
+    case SpriteVertexFormat::Packed:
+      glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE, stride, BUFFER_OFFSET(offset));
+      glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, BUFFER_OFFSET(offset + 8));
+      glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, BUFFER_OFFSET(offset + 12));
+      glVertexAttribPointer(3, 1, GL_UNSIGNED_SHORT, GL_FALSE, stride, BUFFER_OFFSET(offset + 6));
+      break;
+    default:
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(offset));
+      glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(offset + 12));
+      glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, BUFFER_OFFSET(offset + 20));
+      glVertexAttribPointer(3, 1, GL_UNSIGNED_SHORT, GL_FALSE, stride, BUFFER_OFFSET(offset + 24));
+      break;
+    }
+  }
+
+}
\ No newline at end of file
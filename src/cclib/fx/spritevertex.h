@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+
+#include "spritecommandbuffer.h"
+
+namespace fx {
+
+  enum class SpriteVertexFormat {
+    Float,
+    Compact,
+    Packed
+  };
+
+  struct SpriteVertex {
+
+    float x, y, z;
+    float u, v;
+    uint32_t color;
+    uint16_t layer;
+
+    uint8_t reserved[6];
+
+  };
+
+  // 24 bytes: float position, 16-bit normalized UVs, RGBA8 color and texture array layer.
+  struct CompactSpriteVertex {
+
+    float x, y, z;
+    uint16_t u, v;
+    uint32_t color;
+    uint16_t layer;
+    uint16_t reserved;
+
+  };
+
+  // 16 bytes: 16-bit integer position, texture array layer, 16-bit normalized UVs
+  // and RGBA8 color. Only suitable for pixel-aligned sprites within +/-32767: x and y
+  // are rounded and saturated, and z must be a whole number, which SpriteBatch checks
+  // so that its depth sorting matches what is drawn.
+  struct PackedSpriteVertex {
+
+    int16_t x, y, z;
+    uint16_t layer;
+    uint16_t u, v;
+    uint32_t color;
+
+  };
+
+  uint32_t SpriteVertexStride(SpriteVertexFormat format);
+
+  // Whether z survives packing into a PackedSpriteVertex unchanged.
+  bool PackableDepth(float z);
+
+  // Writes the four corners of a sprite, in the order expected by QuadIndexBuffer.
+  // Instantiated for the three vertex types above.
+  template<typename T> void ExpandSprite(const SpriteInstance& sprite, T* vertices);
+
+  // Points attributes 0-3 of the bound vertex array at the bound GL_ARRAY_BUFFER,
+  // starting offset bytes in.
+  void SpriteVertexAttribs(SpriteVertexFormat format, uint32_t offset);
+
+}
\ No newline at end of file
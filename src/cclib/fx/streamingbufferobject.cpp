@@ -5,43 +5,148 @@
 #include <gl/glfw3.h>
 #include <string>
 
+#include "context.h"
+#include "../engineexception.h"
+
 namespace fx {
 
-  StreamingBufferObject::StreamingBufferObject(uint32_t target, uint32_t size)
+  static const GLbitfield PersistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  StreamingBufferObject::StreamingBufferObject(uint32_t target, uint32_t size, uint32_t regions)
     : _target(target)
     , _size(size)
+    , _regions(regions == 0 ? 1 : regions)
+    // Every region starts on the same 64-byte boundary that reservations are rounded to.
+    , _regionSize((size / _regions) & ~63u)
     , _vbo(0)
-    , _cursor(0) {
+    , _cursor(0)
+    , _region(0)
+    , _wraps(0)
+    , _mapped(nullptr)
+    , _reserved(false)
+    , _fences(_regions, nullptr) {
     glGenBuffers(1, &_vbo);
     glBindBuffer(_target, _vbo);
-    glBufferData(_target, _size, nullptr, GL_DYNAMIC_DRAW);
+
+    if (GLEW_ARB_buffer_storage || GLEW_VERSION_4_4) {
+      // Map once for the lifetime of the buffer; the regions are recycled behind fences.
+      glBufferStorage(_target, _size, nullptr, PersistentFlags);
+      _mapped = reinterpret_cast<uint8_t*>(glMapBufferRange(_target, 0, _size, PersistentFlags));
+      if (!_mapped) {
+        // Immutable storage can not be orphaned, so the fallback needs a fresh buffer.
+        glDeleteBuffers(1, &_vbo);
+        glGenBuffers(1, &_vbo);
+        glBindBuffer(_target, _vbo);
+      }
+    }
+    if (!_mapped) {
+      glBufferData(_target, _size, nullptr, GL_DYNAMIC_DRAW);
+    }
   }
 
   StreamingBufferObject::~StreamingBufferObject( ) {
-    if (_vbo != 0) glDeleteBuffers(1, &_vbo);
+    auto fences = _fences;
+    auto target = _target;
+    auto vbo = _vbo;
+    auto mapped = _mapped != nullptr;
+    Context::Release([fences, target, vbo, mapped]( ) {
+      for (auto it = fences.begin( ); it != fences.end( ); ++it) {
+        if (*it) glDeleteSync(reinterpret_cast<GLsync>(*it));
+      }
+      if (mapped) {
+        glBindBuffer(target, vbo);
+        glUnmapBuffer(target);
+      }
+      if (vbo != 0) glDeleteBuffers(1, &vbo);
+    });
   }
 
   const uint32_t StreamingBufferObject::Vbo( ) {
     return _vbo;
   }
 
+  const bool StreamingBufferObject::Persistent( ) {
+    return _mapped != nullptr;
+  }
+
+  const uint32_t StreamingBufferObject::Capacity( ) {
+    return _mapped ? _regionSize : _size;
+  }
+
+  const uint32_t StreamingBufferObject::Wraps( ) {
+    return _wraps;
+  }
+
   uint32_t StreamingBufferObject::StreamImpl(void* start, uint32_t elementSize, uint32_t elementCount) {
     auto bytes = elementSize * elementCount;
-    auto aligned = bytes + bytes % 64;
+    uint32_t offset;
+    std::memcpy(ReserveImpl(bytes, offset), start, bytes);
+    Commit( );
+    return offset;
+  }
+
+  void* StreamingBufferObject::ReserveImpl(uint32_t bytes, uint32_t& offset) {
+    auto aligned = (bytes + 63) & ~63u;
 
     glBindBuffer(_target, _vbo);
 
+    if (_mapped) {
+      offset = Acquire(aligned);
+      return _mapped + offset;
+    }
+
+    if (aligned > _size) {
+      throw EngineException("Streamed data does not fit in the buffer.", ErrorCode::FX_BUFFER_OVERFLOW);
+    }
+
     if (_cursor + aligned > _size) {
       // Orphan the current buffer and get a new one.
       glBufferData(_target, _size, nullptr, GL_DYNAMIC_DRAW);
       _cursor = 0;
+      _wraps++;
     }
 
     auto mapped = glMapBufferRange(_target, _cursor, aligned, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
-    std::memcpy(mapped, start, bytes);
+    _reserved = true;
     _cursor += aligned;
-    glUnmapBuffer(_target);
 
-    return _cursor - aligned;
+    offset = _cursor - aligned;
+    return mapped;
+  }
+
+  void StreamingBufferObject::Commit( ) {
+    // Persistent mappings are coherent; only the fallback path has something to unmap.
+    if (_reserved) {
+      glBindBuffer(_target, _vbo);
+      glUnmapBuffer(_target);
+      _reserved = false;
+    }
+  }
+
+  uint32_t StreamingBufferObject::Acquire(uint32_t bytes) {
+    if (bytes > _regionSize) {
+      throw EngineException("Streamed data does not fit in a buffer region.", ErrorCode::FX_BUFFER_OVERFLOW);
+    }
+
+    if (_cursor + bytes > (_region + 1) * _regionSize) {
+      // Everything drawn from the region we are leaving has been issued by now.
+      _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      _region = (_region + 1) % _regions;
+      _cursor = _region * _regionSize;
+      if (_region == 0) _wraps++;
+
+      auto fence = reinterpret_cast<GLsync>(_fences[_region]);
+      if (fence) {
+        GLenum rc;
+        do {
+          rc = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (rc == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fence);
+        _fences[_region] = nullptr;
+      }
+    }
+
+    _cursor += bytes;
+    return _cursor - bytes;
   }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <vector>
 
 namespace fx {
   class StreamingBufferObject {
@@ -7,20 +8,37 @@ namespace fx {
     StreamingBufferObject(const StreamingBufferObject&) = default;
     StreamingBufferObject& operator=(const StreamingBufferObject&) = delete;
 
-    StreamingBufferObject(uint32_t target, uint32_t size = 0x200000);
+    StreamingBufferObject(uint32_t target, uint32_t size = 0x200000, uint32_t regions = 3);
     ~StreamingBufferObject( );
 
     const uint32_t Vbo( );
+    const bool Persistent( );
+    const uint32_t Capacity( );
+    const uint32_t Wraps( );
 
     template <typename T>
     uint32_t Stream(T& first, uint32_t elementCount) {
       return StreamImpl(&first, sizeof(T), elementCount);
     }
 
+    // Returns writable buffer memory for elementCount elements and its offset in the
+    // buffer. The memory may be write-combined, so fill it sequentially and do not read
+    // it back. Commit must be called before anything draws from it.
+    template <typename T>
+    T* Reserve(uint32_t elementCount, uint32_t& offset) {
+      return reinterpret_cast<T*>(ReserveImpl(sizeof(T) * elementCount, offset));
+    }
+    void Commit( );
+
     private:
     uint32_t StreamImpl(void* start, uint32_t elementSize, uint32_t elementCount);
+    void* ReserveImpl(uint32_t bytes, uint32_t& offset);
+    uint32_t Acquire(uint32_t bytes);
 
-    const uint32_t _target, _size;
-    uint32_t _vbo, _cursor;
+    const uint32_t _target, _size, _regions, _regionSize;
+    uint32_t _vbo, _cursor, _region, _wraps;
+    uint8_t* _mapped;
+    bool _reserved;
+    std::vector<void*> _fences;
   };
 }
\ No newline at end of file
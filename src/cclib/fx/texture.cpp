@@ -1,11 +1,20 @@
 #include "stdafx.h"
 #include "texture.h"
 
+#include <algorithm>
+#include <functional>
+#include <math.h>
 #include <memory>
 
 #include <gl/glew.h>
 #include <gl/glfw3.h>
 
+#include "context.h"
+#include "dds.h"
+#include "gpuprofiler.h"
+#include "gpustatecache.h"
+#include "textureuploader.h"
+#include "texturestreamer.h"
 #include "../content/contentmanager.h"
 #include "../logging.h"
 
@@ -13,91 +22,181 @@ using namespace std;
 
 namespace fx
 {
-  Texture::Texture(const uint32_t id, const uint32_t width, const uint32_t height, const uint32_t linearSize, const uint32_t mipmapCount) :
+  Texture::Texture(const uint32_t id, const uint32_t format, const uint32_t width, const uint32_t height, const uint32_t linearSize, const uint32_t mipmapCount, void* fence) :
     _id(id),
+    _format(format),
     _width(width),
     _height(height),
     _linearSize(linearSize),
-    _mipMapCount(mipmapCount) {
+    _mipMapCount(mipmapCount),
+    _fence(fence),
+    _baseLevel(0),
+    _observed(0.0f) {
 
   }
 
-  Texture::~Texture() {
+  Texture::Texture(const uint32_t id, const std::shared_ptr<content::ContentView>& data, const DdsImage& image, const uint32_t baseLevel, void* fence) :
+    _id(id),
+    _format(image.Format),
+    _width(image.Width),
+    _height(image.Height),
+    _linearSize(image.LinearSize),
+    _mipMapCount((uint32_t) image.Levels.size( )),
+    _fence(fence),
+    _baseLevel(baseLevel),
+    _observed(0.0f),
+    _data(data),
+    _levels(image.Levels) {
+
+  }
 
+  Texture::~Texture() {
+    auto fence = _fence;
+    GLuint id = _id;
+    Context::Release([fence, id]( ) {
+      if (fence) glDeleteSync(reinterpret_cast<GLsync>(fence));
+      glDeleteTextures(1, &id);
+      GpuStateCache::TextureDeleted(id);
+    });
   }
 
   const uint32_t Texture::Id() { return _id; }
+  const uint32_t Texture::Format() { return _format; }
   const uint32_t Texture::Width() { return _width; }
   const uint32_t Texture::Height() { return _height; }
   const uint32_t Texture::LinearSize() { return _linearSize; }
   const uint32_t Texture::MipMapCount() { return _mipMapCount; }
-}
+  const size_t Texture::Size() {
+    auto width = std::max(_width >> _baseLevel, 1u);
+    auto height = std::max(_height >> _baseLevel, 1u);
+    return DdsSize(_format, width, height, _mipMapCount - _baseLevel);
+  }
 
-namespace content
-{
-#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
-#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
-#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
+  const bool Texture::Streamed() { return !_levels.empty( ); }
+  const uint32_t Texture::BaseLevel() { return _baseLevel; }
 
-  template<> shared_ptr<fx::Texture> ContentManager::LoadContent<fx::Texture>(const LoadOperation& operation) {
-    uint8_t header[124];
+  void Texture::Observe(float pixels) {
+    if (pixels > _observed) _observed = pixels;
+  }
 
-    LOG(DEBUG) << L"Loading texture " << operation.Path << L" ...";
-    operation.Data->read(reinterpret_cast<char*>(&header[0]), 4);
-    if (strncmp(reinterpret_cast<char*>(&header[0]), "DDS ", 4) != 0) {
-      LOG(ERROR) << L"Bad texture header " << operation.Path << L" .";
-      throw EngineException("Failed to load texture: " + operation.Path, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+  bool Texture::StreamLevel() {
+    auto observed = _observed;
+    _observed = 0.0f;
+    if (_baseLevel == 0 || observed <= 0.0f) return false;
+
+    // The level whose size is closest to, but not below, what is on screen.
+    auto ratio = std::max(_width, _height) / observed;
+    auto wanted = ratio <= 1.0f ? 0 : (uint32_t) floorf(log2f(ratio));
+    if (wanted >= _baseLevel) return false;
+
+    auto level = _baseLevel - 1;
+    auto& mip = _levels[level];
+
+    // Touching the mapped file here would read it from disk on the GL thread.
+    if (!_prefetch.valid( )) {
+      auto data = _data;
+      auto source = mip;
+      _prefetch = std::async(std::launch::async, [data, source]( ) {
+        return std::vector<uint8_t>(source.Data, source.Data + source.Size);
+      });
+      return false;
     }
-
-    operation.Data->read(reinterpret_cast<char*>(&header[0]), 124);
-    auto height = *(uint32_t*)&(header[8]);
-    auto width = *(uint32_t*)&(header[12]);
-    auto linearSize = *(uint32_t*)&(header[16]);
-    auto mipMapCount = *(uint32_t*)&(header[24]);
-    auto fourCC = *(uint32_t*)&(header[80]);
-    uint32_t format;
-
-    switch (fourCC)
-    {
-    case FOURCC_DXT1: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
-    case FOURCC_DXT3: format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
-    case FOURCC_DXT5: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
-    default:
-      LOG(ERROR) << L"Unsupported FOURCC: " << fourCC << ": " << operation.Path << L" .";
-      throw EngineException("Failed to load texture: " + operation.Path, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+    if (_prefetch.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    auto pixels = _prefetch.get( );
+
+    GpuProfileScope scope(*GpuProfiler::Shared( ), "Texture::StreamLevel");
+    auto uploader = TextureUploader::Shared( );
+    GpuStateCache::Shared( )->BindTexture(GL_TEXTURE_2D, _id);
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, _format, mip.Width, mip.Height, 0, mip.Size, uploader->Stage(pixels.data( ), mip.Size));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    _baseLevel = level;
+
+    if (_fence) glDeleteSync(reinterpret_cast<GLsync>(_fence));
+    _fence = uploader->Finish( );
+
+    // Nothing is left to stream, so the file no longer needs to stay mapped.
+    if (_baseLevel == 0) {
+      _levels.clear( );
+      _data.reset( );
     }
+    return true;
+  }
 
-    if (linearSize > 104857600)
-    {
-      LOG(ERROR) << L"Texture too large " << operation.Path << L" .";
-      throw EngineException("Failed to load texture: " + operation.Path, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
-    }
+  const bool Texture::Ready() {
+    if (!_fence) return true;
 
-    size_t bufferSize = mipMapCount > 1 ? linearSize * 2 : linearSize;
-    auto buffer = reinterpret_cast<uint8_t*>(malloc(bufferSize));
-    operation.Data->read(reinterpret_cast<char*>(buffer), bufferSize);
-    
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    uint32_t blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
-    size_t offset = 0;
-    for (uint32_t level = 0; level < mipMapCount && (width || height); ++level)
-    {
-      uint32_t size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
-      glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, size, buffer + offset);
-
-      offset += size;
-      width /= 2;
-      height /= 2;
-    }
-    free(buffer);
+    auto status = glClientWaitSync(reinterpret_cast<GLsync>(_fence), 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+    glDeleteSync(reinterpret_cast<GLsync>(_fence));
+    _fence = nullptr;
+    return true;
+  }
+}
 
-    return make_shared<fx::Texture>(textureID, width, height, linearSize, mipMapCount);
+namespace content
+{
+  template<> function<shared_ptr<fx::Texture>( )> ContentManager::PrepareContent<fx::Texture>(const LoadOperation& operation) {
+    auto data = operation.Data;
+
+    LOG(DEBUG) << L"Loading texture " << operation.Path << L" ...";
+    auto image = fx::ReadDds(*data, operation.Path);
+    auto levels = (uint32_t) image.Levels.size( );
+    auto base = fx::TextureStreamer::Shared( )->FirstLevel(image);
+
+    // The levels uploaded now are read here, on the worker. A streamed texture keeps
+    // the mapped image for the levels it has yet to stream in.
+    auto resident = image;
+    auto buffer = fx::LoadDdsLevels(resident, base, levels);
+
+    // Each mip is staged through the shared unpack buffer ring.
+    return [data, image, resident, buffer, levels, base]( ) -> shared_ptr<fx::Texture> {
+      fx::GpuProfileScope scope(*fx::GpuProfiler::Shared( ), "Texture upload");
+      auto uploader = fx::TextureUploader::Shared( );
+
+      GLuint textureID;
+      glGenTextures(1, &textureID);
+      fx::GpuStateCache::Shared( )->BindTexture(GL_TEXTURE_2D, textureID);
+
+      if (base > 0) {
+        // Mutable storage, so that levels above the base take no memory until they
+        // are streamed in.
+        for (uint32_t level = base; level < levels; ++level) {
+          auto& mip = resident.Levels[level];
+          glCompressedTexImage2D(GL_TEXTURE_2D, level, image.Format, mip.Width, mip.Height, 0, mip.Size, uploader->Stage(mip.Data, mip.Size));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+        auto texture = make_shared<fx::Texture>(textureID, data, image, base, uploader->Finish( ));
+        fx::TextureStreamer::Shared( )->Track(texture);
+        return texture;
+      }
+
+      if (GLEW_ARB_texture_storage || GLEW_VERSION_4_2) {
+        // Immutable storage: the driver knows the whole mip chain up front.
+        glTexStorage2D(GL_TEXTURE_2D, levels, image.Format, image.Width, image.Height);
+        for (uint32_t level = 0; level < levels; ++level) {
+          auto& mip = resident.Levels[level];
+          glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.Width, mip.Height, image.Format, mip.Size, uploader->Stage(mip.Data, mip.Size));
+        }
+      } else {
+        for (uint32_t level = 0; level < levels; ++level) {
+          auto& mip = resident.Levels[level];
+          glCompressedTexImage2D(GL_TEXTURE_2D, level, image.Format, mip.Width, mip.Height, 0, mip.Size, uploader->Stage(mip.Data, mip.Size));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+      }
+
+      return make_shared<fx::Texture>(textureID, image.Format, image.Width, image.Height, image.LinearSize, levels, uploader->Finish( ));
+    };
   }
 
   template<> const string ContentManager::ContentExtension<fx::Texture>() {
     return ".dds";
   }
+
+  template<> const size_t ContentManager::ContentSize<fx::Texture>(fx::Texture& content) {
+    return content.Size( );
+  }
 }
\ No newline at end of file
@@ -1,5 +1,10 @@
 #pragma once
+#include <future>
+#include <memory>
 #include <stdint.h>
+#include <vector>
+
+#include "dds.h"
 
 namespace fx
 {
@@ -8,20 +13,50 @@ namespace fx
     Texture& operator=(const Texture&) = delete;
 
     public:
-    Texture(const uint32_t id, const uint32_t width, const uint32_t height, const uint32_t linearSize, const uint32_t mipmapCount);
+    Texture(const uint32_t id, const uint32_t format, const uint32_t width, const uint32_t height, const uint32_t linearSize, const uint32_t mipmapCount, void* fence = nullptr);
+    // A streamed texture: only the levels from baseLevel down are uploaded, and the
+    // rest are read from the image, which points into data, as they are needed.
+    Texture(const uint32_t id, const std::shared_ptr<content::ContentView>& data, const DdsImage& image, const uint32_t baseLevel, void* fence = nullptr);
     ~Texture( );
 
     const uint32_t Id( );
+    const uint32_t Format( );
     const uint32_t Width( );
     const uint32_t Height( );
     const uint32_t LinearSize( );
     const uint32_t MipMapCount( );
 
+    // Bytes of GPU memory taken by the uploaded mip levels.
+    const size_t Size( );
+
+    const bool Streamed( );
+    // The finest mip level uploaded so far; zero once the texture is complete.
+    const uint32_t BaseLevel( );
+    // Records the largest on-screen extent, in pixels, the texture was drawn at.
+    void Observe(float pixels);
+    // Uploads the next finer level if the observed size calls for it and resets the
+    // observation. The level is first read from the file on another thread, and only
+    // uploaded by a later call once it is in memory. Returns whether a level was
+    // uploaded. GL thread only.
+    bool StreamLevel( );
+
+    // True once the GPU has finished copying the texture's data. Drawing with it
+    // earlier is correct but may stall.
+    const bool Ready( );
+
     private:
     const uint32_t _id;
+    const uint32_t _format;
     const uint32_t _width;
     const uint32_t _height;
     const uint32_t _linearSize;
     const uint32_t _mipMapCount;
+    void* _fence;
+
+    uint32_t _baseLevel;
+    float _observed;
+    std::shared_ptr<content::ContentView> _data;
+    std::vector<DdsLevel> _levels;
+    std::future<std::vector<uint8_t>> _prefetch;
   };
 }
\ No newline at end of file
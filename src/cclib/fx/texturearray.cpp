@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include "texturearray.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+#include <rapidjson/document.h>
+#include <rapidjson/memorystream.h>
+
+#include "context.h"
+#include "dds.h"
+#include "gpuprofiler.h"
+#include "gpustatecache.h"
+#include "texture.h"
+#include "textureuploader.h"
+#include "../content/contentmanager.h"
+#include "../logging.h"
+
+using namespace std;
+
+namespace fx
+{
+  TextureArray::TextureArray(const uint32_t id, const uint32_t format, const uint32_t width, const uint32_t height, const uint32_t layers, const uint32_t mipmapCount, void* fence) :
+    _id(id),
+    _format(format),
+    _width(width),
+    _height(height),
+    _layers(layers),
+    _mipMapCount(mipmapCount),
+    _fence(fence) {
+
+  }
+
+  TextureArray::~TextureArray() {
+    auto fence = _fence;
+    GLuint id = _id;
+    Context::Release([fence, id]( ) {
+      if (fence) glDeleteSync(reinterpret_cast<GLsync>(fence));
+      glDeleteTextures(1, &id);
+      GpuStateCache::TextureDeleted(id);
+    });
+  }
+
+  const uint32_t TextureArray::Id() { return _id; }
+  const uint32_t TextureArray::Format() { return _format; }
+  const uint32_t TextureArray::Width() { return _width; }
+  const uint32_t TextureArray::Height() { return _height; }
+  const uint32_t TextureArray::Layers() { return _layers; }
+  const uint32_t TextureArray::MipMapCount() { return _mipMapCount; }
+  const size_t TextureArray::Size() { return DdsSize(_format, _width, _height, _mipMapCount) * _layers; }
+
+  const bool TextureArray::Ready() {
+    if (!_fence) return true;
+
+    auto status = glClientWaitSync(reinterpret_cast<GLsync>(_fence), 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+    glDeleteSync(reinterpret_cast<GLsync>(_fence));
+    _fence = nullptr;
+    return true;
+  }
+}
+
+namespace content
+{
+  template<> function<shared_ptr<fx::TextureArray>( )> ContentManager::PrepareContent<fx::TextureArray>(const LoadOperation& operation) {
+    rapidjson::MemoryStream stream(reinterpret_cast<const char*>(operation.Data->Data( )), operation.Data->Size( ));
+    rapidjson::Document d;
+    d.ParseStream(stream);
+
+    if (d.HasParseError( ))
+      throw EngineException("Failed to parse: " + operation.Path, ErrorCode::CONTENT_INVALID_DATA);
+
+    auto layers = d.FindMember("layers");
+    if (layers == d.MemberEnd( ) || !layers->value.IsArray( ) || layers->value.Size( ) == 0)
+      throw EngineException("Expected non-empty 'layers' array member: " + operation.Path, ErrorCode::CONTENT_INVALID_DATA);
+
+    LOG(DEBUG) << L"Loading texture array " << operation.Path << L" ...";
+
+    vector<shared_ptr<vector<uint8_t>>> buffers;
+    vector<fx::DdsImage> images;
+    for (auto it = layers->value.Begin( ); it != layers->value.End( ); ++it) {
+      if (!it->IsString( ))
+        throw EngineException("The 'layers' member must only contain strings: " + operation.Path, ErrorCode::CONTENT_INVALID_DATA);
+
+      string fullPath, relativePath;
+      operation.ContentManager.Resolve(operation.ContentManager.Combine(operation.Path, string(it->GetString( )) + ContentExtension<fx::Texture>( )), fullPath, relativePath);
+      auto view = operation.ContentManager.Open(fullPath, relativePath);
+      auto image = fx::ReadDds(*view, relativePath);
+
+      auto& first = images.empty( ) ? image : images[0];
+      if (image.Format != first.Format || image.Width != first.Width || image.Height != first.Height || image.Levels.size( ) != first.Levels.size( ))
+        throw EngineException("Texture array layers must share format, size and mip count: " + relativePath, ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+
+      // Read on the worker; the GL thread only copies from memory.
+      buffers.push_back(fx::LoadDdsLevels(image, 0, (uint32_t) image.Levels.size( )));
+      images.push_back(image);
+    }
+
+    return [buffers, images]( ) -> shared_ptr<fx::TextureArray> {
+      fx::GpuProfileScope scope(*fx::GpuProfiler::Shared( ), "TextureArray upload");
+      auto uploader = fx::TextureUploader::Shared( );
+      auto& first = images[0];
+      auto layers = (uint32_t) images.size( );
+      auto levels = (uint32_t) first.Levels.size( );
+
+      GLuint textureID;
+      glGenTextures(1, &textureID);
+      fx::GpuStateCache::Shared( )->BindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+      if (GLEW_ARB_texture_storage || GLEW_VERSION_4_2) {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, first.Format, first.Width, first.Height, layers);
+      } else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (uint32_t level = 0; level < levels; ++level) {
+          auto& mip = first.Levels[level];
+          glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, first.Format, mip.Width, mip.Height, layers, 0, mip.Size * layers, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+      }
+
+      for (uint32_t layer = 0; layer < layers; ++layer) {
+        for (uint32_t level = 0; level < levels; ++level) {
+          auto& mip = images[layer].Levels[level];
+          glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.Width, mip.Height, 1, first.Format, mip.Size, uploader->Stage(mip.Data, mip.Size));
+        }
+      }
+
+      return make_shared<fx::TextureArray>(textureID, first.Format, first.Width, first.Height, layers, levels, uploader->Finish( ));
+    };
+  }
+
+  template<> const string ContentManager::ContentExtension<fx::TextureArray>() {
+    return ".json";
+  }
+
+  template<> const size_t ContentManager::ContentSize<fx::TextureArray>(fx::TextureArray& content) {
+    return content.Size( );
+  }
+}
\ No newline at end of file
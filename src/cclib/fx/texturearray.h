@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+
+namespace fx
+{
+  // Same-sized, same-format DDS images in one GL_TEXTURE_2D_ARRAY, so that sprites
+  // using any of them can share a draw call. Loaded from a JSON file listing the
+  // images relative to it: { "layers": [ "grass", "stone" ] }.
+  class TextureArray {
+    TextureArray(const TextureArray&) = default;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    public:
+    TextureArray(const uint32_t id, const uint32_t format, const uint32_t width, const uint32_t height, const uint32_t layers, const uint32_t mipmapCount, void* fence = nullptr);
+    ~TextureArray( );
+
+    const uint32_t Id( );
+    const uint32_t Format( );
+    const uint32_t Width( );
+    const uint32_t Height( );
+    const uint32_t Layers( );
+    const uint32_t MipMapCount( );
+
+    // Bytes of GPU memory taken by all layers and mips.
+    const size_t Size( );
+
+    // True once the GPU has finished copying the images. Drawing with the array
+    // earlier is correct but may stall.
+    const bool Ready( );
+
+    private:
+    const uint32_t _id;
+    const uint32_t _format;
+    const uint32_t _width;
+    const uint32_t _height;
+    const uint32_t _layers;
+    const uint32_t _mipMapCount;
+    void* _fence;
+  };
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include "stdafx.h"
+#include "textureatlas.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "gpustatecache.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+  // Compressed formats are copied in whole 4x4 blocks, so slots start on block boundaries.
+  static const uint32_t BlockAlign = 4;
+
+  static uint32_t AlignBlock(uint32_t value) {
+    return (value + BlockAlign - 1) & ~(BlockAlign - 1);
+  }
+
+  static uint32_t BlockBytes(uint32_t format) {
+    return format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16;
+  }
+
+  TextureAtlas::TextureAtlas(uint32_t pageSize, uint32_t padding)
+    : _pageSize(AlignBlock(pageSize))
+    , _padding(AlignBlock(padding))
+    , _staging(0)
+    , _stagingSize(0) {
+  }
+
+  TextureAtlas::~TextureAtlas( ) {
+    auto staging = _staging;
+    if (staging != 0) Context::Release([staging]( ) { glDeleteBuffers(1, &staging); });
+  }
+
+  const uint32_t TextureAtlas::PageSize( ) {
+    return _pageSize;
+  }
+
+  const uint32_t TextureAtlas::Pages( ) {
+    return (uint32_t) _pages.size( );
+  }
+
+  Texture& TextureAtlas::Page(uint32_t index) {
+    return *_pages[index].Image;
+  }
+
+  AtlasRegion TextureAtlas::Insert(Texture& texture) {
+    // Level 0 is copied, and a texture still streaming has not uploaded it yet.
+    if (texture.BaseLevel( ) > 0) {
+      throw EngineException("Textures still streaming in can not be added to an atlas.", ErrorCode::FX_TEXTURE_LOAD_FAILURE);
+    }
+
+    uint32_t slotWidth, slotHeight;
+    Slot(texture.Width( ), texture.Height( ), slotWidth, slotHeight);
+    if (slotWidth > _pageSize || slotHeight > _pageSize) {
+      throw EngineException("Texture does not fit in an atlas page.", ErrorCode::FX_ATLAS_OVERFLOW);
+    }
+
+    uint32_t x = 0, y = 0;
+    AtlasPage* page = nullptr;
+    for (auto it = _pages.begin( ); it != _pages.end( ) && !page; ++it) {
+      if (it->Image->Format( ) == texture.Format( ) && Allocate(*it, slotWidth, slotHeight, x, y)) page = &*it;
+    }
+    if (!page) {
+      page = &Open(texture.Format( ));
+      Allocate(*page, slotWidth, slotHeight, x, y);
+    }
+
+    Copy(texture, *page, x, y);
+    page->Live.insert((uint64_t) x << 32 | y);
+
+    AtlasRegion region;
+    region.Page = (uint32_t) (page - _pages.data( ));
+    region.Generation = page->Generation;
+    region.TextureId = page->Image->Id( );
+    region.X = x;
+    region.Y = y;
+    region.Width = texture.Width( );
+    region.Height = texture.Height( );
+    region.U0 = (uint16_t) ((uint64_t) x * 0xFFFF / _pageSize);
+    // The sprite shaders sample at 1 - v, so V is measured from the far edge of the
+    // page; that way a region samples its own slot the right way up, like its source.
+    region.V0 = (uint16_t) ((uint64_t) (_pageSize - y - region.Height) * 0xFFFF / _pageSize);
+    region.U1 = (uint16_t) ((uint64_t) (x + region.Width) * 0xFFFF / _pageSize);
+    region.V1 = (uint16_t) ((uint64_t) (_pageSize - y) * 0xFFFF / _pageSize);
+    return region;
+  }
+
+  void TextureAtlas::Remove(const AtlasRegion& region) {
+    if (region.Page >= _pages.size( )) return;
+    auto& page = _pages[region.Page];
+    if (region.Generation != page.Generation || page.Live.erase((uint64_t) region.X << 32 | region.Y) == 0) return;
+
+    if (page.Live.empty( )) {
+      Reset(page);
+      return;
+    }
+
+    FreeRect rect = { region.X, region.Y, 0, 0 };
+    Slot(region.Width, region.Height, rect.width, rect.height);
+    page.Free.push_back(rect);
+  }
+
+  void TextureAtlas::Slot(uint32_t width, uint32_t height, uint32_t& slotWidth, uint32_t& slotHeight) {
+    slotWidth = AlignBlock(width) + _padding;
+    slotHeight = AlignBlock(height) + _padding;
+  }
+
+  bool TextureAtlas::Allocate(AtlasPage& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y) {
+    // Reuse the tightest freed slot first and split what is left of it.
+    auto best = page.Free.end( );
+    for (auto it = page.Free.begin( ); it != page.Free.end( ); ++it) {
+      if (it->width < width || it->height < height) continue;
+      if (best == page.Free.end( ) || it->width * it->height < best->width * best->height) best = it;
+    }
+    if (best != page.Free.end( )) {
+      auto rect = *best;
+      page.Free.erase(best);
+      x = rect.x;
+      y = rect.y;
+      if (rect.width > width) page.Free.push_back({ rect.x + width, rect.y, rect.width - width, height });
+      if (rect.height > height) page.Free.push_back({ rect.x, rect.y + height, rect.width, rect.height - height });
+      return true;
+    }
+
+    // Otherwise place it on the skyline where it ends up lowest.
+    auto bestIndex = page.Skyline.size( );
+    auto bestBottom = std::numeric_limits<uint32_t>::max( );
+    auto bestWidth = std::numeric_limits<uint32_t>::max( );
+    for (size_t i = 0; i < page.Skyline.size( ); ++i) {
+      uint32_t top;
+      if (!Fit(page, i, width, height, top)) continue;
+      if (top + height < bestBottom || (top + height == bestBottom && page.Skyline[i].width < bestWidth)) {
+        bestIndex = i;
+        bestBottom = top + height;
+        bestWidth = page.Skyline[i].width;
+        y = top;
+      }
+    }
+    if (bestIndex == page.Skyline.size( )) return false;
+
+    x = page.Skyline[bestIndex].x;
+    page.Skyline.insert(page.Skyline.begin( ) + bestIndex, { x, y + height, width });
+
+    // Trim the nodes now covered by the new one.
+    for (auto i = bestIndex + 1; i < page.Skyline.size( ); ) {
+      auto& previous = page.Skyline[i - 1];
+      auto& node = page.Skyline[i];
+      auto end = previous.x + previous.width;
+      if (node.x >= end) break;
+
+      auto shrink = end - node.x;
+      if (node.width <= shrink) {
+        page.Skyline.erase(page.Skyline.begin( ) + i);
+        continue;
+      }
+      node.x += shrink;
+      node.width -= shrink;
+      break;
+    }
+
+    for (size_t i = 0; i + 1 < page.Skyline.size( ); ) {
+      if (page.Skyline[i].y == page.Skyline[i + 1].y) {
+        page.Skyline[i].width += page.Skyline[i + 1].width;
+        page.Skyline.erase(page.Skyline.begin( ) + i + 1);
+      } else {
+        ++i;
+      }
+    }
+    return true;
+  }
+
+  bool TextureAtlas::Fit(AtlasPage& page, size_t index, uint32_t width, uint32_t height, uint32_t& y) {
+    auto x = page.Skyline[index].x;
+    if (x + width > _pageSize) return false;
+
+    y = page.Skyline[index].y;
+    auto remaining = (int64_t) width;
+    for (auto i = index; remaining > 0; ++i) {
+      y = std::max(y, page.Skyline[i].y);
+      if (y + height > _pageSize) return false;
+      remaining -= page.Skyline[i].width;
+    }
+    return true;
+  }
+
+  void TextureAtlas::Reset(AtlasPage& page) {
+    page.Generation++;
+    page.Live.clear( );
+    page.Free.clear( );
+    page.Skyline.assign(1, { 0, 0, _pageSize });
+  }
+
+  TextureAtlas::AtlasPage& TextureAtlas::Open(uint32_t format) {
+    auto levelSize = (_pageSize / BlockAlign) * (_pageSize / BlockAlign) * BlockBytes(format);
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    GpuStateCache::Shared( )->BindTexture(GL_TEXTURE_2D, textureID);
+    if (GLEW_ARB_texture_storage || GLEW_VERSION_4_2) {
+      glTexStorage2D(GL_TEXTURE_2D, 1, format, _pageSize, _pageSize);
+    } else {
+      glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, _pageSize, _pageSize, 0, levelSize, nullptr);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    AtlasPage page;
+    page.Generation = 0;
+    page.Image = std::make_shared<Texture>(textureID, format, _pageSize, _pageSize, levelSize, 1);
+    Reset(page);
+    _pages.push_back(page);
+    return _pages.back( );
+  }
+
+  void TextureAtlas::Copy(Texture& source, AtlasPage& page, uint32_t x, uint32_t y) {
+    // The slot is block aligned, and a region that ends at the source's edge may be
+    // a partial block, so the source's own size is copied.
+    if (GLEW_ARB_copy_image || GLEW_VERSION_4_3) {
+      glCopyImageSubData(source.Id( ), GL_TEXTURE_2D, 0, 0, 0, 0,
+                         page.Image->Id( ), GL_TEXTURE_2D, 0, x, y, 0,
+                         source.Width( ), source.Height( ), 1);
+      return;
+    }
+
+    // Without copy_image, read the compressed blocks into a buffer object and upload
+    // them from there; the data never leaves the GPU. The read returns whole blocks.
+    auto width = AlignBlock(source.Width( ));
+    auto height = AlignBlock(source.Height( ));
+    auto size = (width / BlockAlign) * (height / BlockAlign) * BlockBytes(source.Format( ));
+
+    if (_staging == 0) glGenBuffers(1, &_staging);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _staging);
+    if (size > _stagingSize) {
+      glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_COPY);
+      _stagingSize = size;
+    }
+    auto state = GpuStateCache::Shared( );
+    state->BindTexture(GL_TEXTURE_2D, source.Id( ));
+    glGetCompressedTexImage(GL_TEXTURE_2D, 0, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging);
+    state->BindTexture(GL_TEXTURE_2D, page.Image->Id( ));
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, source.Format( ), size, nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+}
\ No newline at end of file
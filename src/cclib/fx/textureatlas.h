@@ -0,0 +1,76 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+#include <unordered_set>
+#include <vector>
+
+#include "texture.h"
+
+namespace fx {
+
+  // Where an image was placed in a TextureAtlas. The UVs are 16-bit normalized like
+  // SpriteInstance's, so they can be copied straight into a sprite.
+  struct AtlasRegion {
+    uint32_t Page;
+    // Incremented each time the page is reset, so that stale regions can be told apart.
+    uint32_t Generation;
+    uint32_t TextureId;
+    uint32_t X, Y;
+    uint32_t Width, Height;
+    uint16_t U0, V0, U1, V1;
+  };
+
+  // Packs loaded textures into large pages so that sprites using different images
+  // can share a batch. Images are copied GPU-side into a page of the same format,
+  // placed with a skyline packer; removed regions are reused by later insertions and
+  // a page is reset once all of its regions are gone. Pages only hold the base level.
+  // Must be used on the GL thread.
+  class TextureAtlas {
+    public:
+    TextureAtlas(const TextureAtlas&) = default;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    TextureAtlas(uint32_t pageSize = 2048, uint32_t padding = 4);
+    ~TextureAtlas( );
+
+    // Throws FX_ATLAS_OVERFLOW if the texture does not fit in an empty page, and
+    // FX_TEXTURE_LOAD_FAILURE if it is streamed and level 0 is not resident yet.
+    AtlasRegion Insert(Texture& texture);
+    // Regions already removed, or from a page reset since, are ignored.
+    void Remove(const AtlasRegion& region);
+
+    const uint32_t PageSize( );
+    const uint32_t Pages( );
+    Texture& Page(uint32_t index);
+
+    private:
+    struct SkylineNode {
+      uint32_t x, y, width;
+    };
+
+    struct FreeRect {
+      uint32_t x, y, width, height;
+    };
+
+    struct AtlasPage {
+      std::shared_ptr<fx::Texture> Image;
+      uint32_t Generation;
+      // Positions of the live regions, packed as x << 32 | y.
+      std::unordered_set<uint64_t> Live;
+      std::vector<SkylineNode> Skyline;
+      std::vector<FreeRect> Free;
+    };
+
+    const uint32_t _pageSize, _padding;
+    uint32_t _staging, _stagingSize;
+    std::vector<AtlasPage> _pages;
+
+    void Slot(uint32_t width, uint32_t height, uint32_t& slotWidth, uint32_t& slotHeight);
+    bool Allocate(AtlasPage& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+    bool Fit(AtlasPage& page, size_t index, uint32_t width, uint32_t height, uint32_t& y);
+    void Reset(AtlasPage& page);
+    AtlasPage& Open(uint32_t format);
+    void Copy(Texture& source, AtlasPage& page, uint32_t x, uint32_t y);
+  };
+
+}
\ No newline at end of file
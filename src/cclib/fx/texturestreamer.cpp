@@ -0,0 +1,72 @@
+#include "stdafx.h"
+#include "texturestreamer.h"
+
+#include <algorithm>
+
+#include "context.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+  TextureStreamer::TextureStreamer( )
+    : _streamSize(2048)
+    , _initialSize(256)
+    , _next(0) {
+
+  }
+
+  TextureStreamer::~TextureStreamer( ) {
+
+  }
+
+  std::shared_ptr<TextureStreamer> TextureStreamer::Shared( ) {
+    auto context = Context::Current( );
+    if (!context) {
+      throw EngineException("Textures can only be streamed with a current context.", ErrorCode::FX_NO_CONTEXT);
+    }
+    return context->Shared<TextureStreamer>( );
+  }
+
+  void TextureStreamer::Thresholds(uint32_t streamSize, uint32_t initialSize) {
+    _streamSize = streamSize;
+    _initialSize = initialSize;
+  }
+
+  const uint32_t TextureStreamer::FirstLevel(const DdsImage& image) {
+    const uint32_t streamSize = _streamSize;
+    const uint32_t initialSize = _initialSize;
+    if (streamSize == 0 || std::max(image.Width, image.Height) < streamSize) return 0;
+
+    uint32_t level = 0;
+    while (level + 1 < image.Levels.size( ) && std::max(image.Levels[level].Width, image.Levels[level].Height) > initialSize) {
+      ++level;
+    }
+    return level;
+  }
+
+  void TextureStreamer::Track(const std::shared_ptr<Texture>& texture) {
+    _textures.push_back(texture);
+  }
+
+  void TextureStreamer::Update(uint32_t levels) {
+    // Round-robin, so that a busy frame does not always favour the same textures.
+    uint32_t uploaded = 0;
+    for (size_t visited = 0, count = _textures.size( ); visited < count && uploaded < levels && !_textures.empty( ); ++visited) {
+      if (_next >= _textures.size( )) _next = 0;
+
+      auto texture = _textures[_next].lock( );
+      if (!texture || !texture->Streamed( )) {
+        _textures.erase(_textures.begin( ) + _next);
+        continue;
+      }
+
+      if (texture->StreamLevel( )) ++uploaded;
+      ++_next;
+    }
+  }
+
+  const size_t TextureStreamer::Tracked( ) {
+    return _textures.size( );
+  }
+
+}
\ No newline at end of file
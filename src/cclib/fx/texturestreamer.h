@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "dds.h"
+#include "texture.h"
+
+namespace fx {
+
+  // Decides which textures are streamed and feeds them finer mip levels over time.
+  // Large textures start with only their small mips uploaded, so they are usable at
+  // once; Update then uploads the next finer level of any texture drawn bigger than
+  // its current base level. One instance is shared per context through Context::Shared.
+  class TextureStreamer {
+    public:
+    TextureStreamer(const TextureStreamer&) = default;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    TextureStreamer( );
+    ~TextureStreamer( );
+
+    // The current context's streamer.
+    static std::shared_ptr<TextureStreamer> Shared( );
+
+    // Textures whose larger side is at least streamSize are streamed, starting at the
+    // first level no larger than initialSize. A streamSize of zero disables streaming.
+    void Thresholds(uint32_t streamSize, uint32_t initialSize);
+
+    // The level a newly loaded texture starts at; zero when it is not streamed. Safe
+    // to call from content workers.
+    const uint32_t FirstLevel(const DdsImage& image);
+    void Track(const std::shared_ptr<Texture>& texture);
+
+    // Uploads at most levels mip levels across the tracked textures. GL thread only.
+    void Update(uint32_t levels = 4);
+    const size_t Tracked( );
+
+    private:
+    std::atomic<uint32_t> _streamSize, _initialSize;
+    size_t _next;
+    std::vector<std::weak_ptr<Texture>> _textures;
+  };
+
+}
\ No newline at end of file
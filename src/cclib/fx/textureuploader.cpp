@@ -0,0 +1,52 @@
+#include "stdafx.h"
+#include "textureuploader.h"
+
+#include <string.h>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+# define BUFFER_OFFSET(i) ((char*)nullptr + (i))
+
+  TextureUploader::TextureUploader( )
+    : _buffer(GL_PIXEL_UNPACK_BUFFER, 0x1000000, 4) {
+
+  }
+
+  TextureUploader::~TextureUploader( ) {
+
+  }
+
+  std::shared_ptr<TextureUploader> TextureUploader::Shared( ) {
+    auto context = Context::Current( );
+    if (!context) {
+      throw EngineException("Textures can only be uploaded with a current context.", ErrorCode::FX_NO_CONTEXT);
+    }
+    return context->Shared<TextureUploader>( );
+  }
+
+  const void* TextureUploader::Stage(const uint8_t* data, uint32_t size) {
+    if (size > _buffer.Capacity( )) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return data;
+    }
+
+    uint32_t offset;
+    memcpy(_buffer.Reserve<uint8_t>(size, offset), data, size);
+    _buffer.Commit( );
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer.Vbo( ));
+    return BUFFER_OFFSET(offset);
+  }
+
+  void* TextureUploader::Finish( ) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+
+#include "streamingbufferobject.h"
+
+namespace fx {
+
+  // Stages texture data in a ring of pixel unpack buffers so that glTex*Image calls
+  // source GPU-visible memory instead of making the driver copy client memory
+  // before they return. One instance is shared per context through Context::Shared.
+  class TextureUploader {
+    public:
+    TextureUploader(const TextureUploader&) = default;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    TextureUploader( );
+    ~TextureUploader( );
+
+    // The current context's uploader.
+    static std::shared_ptr<TextureUploader> Shared( );
+
+    // Copies size bytes into the ring and returns the pointer argument to pass to the
+    // next glTex*Image call, with the unpack buffer left bound. Data that does not fit
+    // in one region is returned as-is with no unpack buffer bound.
+    const void* Stage(const uint8_t* data, uint32_t size);
+
+    // Unbinds the unpack buffer and returns a fence covering everything staged so
+    // far. The caller owns the fence.
+    void* Finish( );
+
+    private:
+    StreamingBufferObject _buffer;
+  };
+
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "stdafx.h"
+#include "uniformbuffer.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include <gl/glew.h>
+#include <gl/glfw3.h>
+
+#include "context.h"
+#include "../engineexception.h"
+
+namespace fx {
+
+  // Copies kept in flight per ring region.
+  static const uint32_t UniformCopiesPerRegion = 256;
+  static const uint32_t UniformRegions = 3;
+
+  // Every copy must start on the driver's offset alignment. The ring itself rounds
+  // reservations to 64 bytes, so a stride that is a multiple of both keeps each
+  // offset aligned.
+  static uint32_t UniformStride(uint32_t size) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    auto align = std::max<uint32_t>(64, alignment);
+    align = ((align + 63) / 64) * 64;
+    return ((size + align - 1) / align) * align;
+  }
+
+  UniformBuffer::UniformBuffer(uint32_t binding, uint32_t size)
+    : _binding(binding)
+    , _size(size)
+    , _stride(UniformStride(size))
+    , _buffer(GL_UNIFORM_BUFFER, _stride * UniformCopiesPerRegion * UniformRegions, UniformRegions) {
+
+  }
+
+  UniformBuffer::~UniformBuffer( ) {
+
+  }
+
+  const uint32_t UniformBuffer::Binding( ) {
+    return _binding;
+  }
+
+  void UniformBuffer::Update(const void* data) {
+    uint32_t offset;
+    memcpy(_buffer.Reserve<uint8_t>(_stride, offset), data, _size);
+    _buffer.Commit( );
+    glBindBufferRange(GL_UNIFORM_BUFFER, _binding, _buffer.Vbo( ), offset, _size);
+  }
+
+  FrameUniformBuffer::FrameUniformBuffer( )
+    : UniformBuffer(FrameUniformBinding, sizeof(FrameUniforms)) {
+
+  }
+
+  FrameUniformBuffer::~FrameUniformBuffer( ) {
+
+  }
+
+  std::shared_ptr<FrameUniformBuffer> FrameUniformBuffer::Shared( ) {
+    auto context = Context::Current( );
+    if (!context) {
+      throw EngineException("Uniform buffers can only be used with a current context.", ErrorCode::FX_NO_CONTEXT);
+    }
+    return context->Shared<FrameUniformBuffer>( );
+  }
+
+  void FrameUniformBuffer::Update(const FrameUniforms& uniforms) {
+    UniformBuffer::Update(&uniforms);
+  }
+
+}
\ No newline at end of file
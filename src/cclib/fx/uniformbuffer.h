@@ -0,0 +1,61 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+
+#include "streamingbufferobject.h"
+#include "../math.h"
+
+namespace fx {
+
+  // Streams a std140 uniform block through a buffer ring and binds each new copy to a
+  // fixed binding point, so that every program using the block sees it without any
+  // per-program uniform calls.
+  class UniformBuffer {
+    public:
+    UniformBuffer(const UniformBuffer&) = default;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    UniformBuffer(uint32_t binding, uint32_t size);
+    ~UniformBuffer( );
+
+    const uint32_t Binding( );
+
+    // Copies the block's size bytes from data and binds them to the binding point.
+    void Update(const void* data);
+
+    private:
+    const uint32_t _binding, _size, _stride;
+    StreamingBufferObject _buffer;
+  };
+
+  // The per-frame block shaders can declare to share view, projection and time:
+  //   layout(std140) uniform Frame { mat4 View; mat4 Projection; mat4 ViewProjection; vec4 Time; };
+  // Time holds the total and the frame's elapsed seconds in x and y.
+  struct FrameUniforms {
+    math::mat4 View;
+    math::mat4 Projection;
+    math::mat4 ViewProjection;
+    math::vec4 Time;
+  };
+
+  static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms must match the std140 layout of the Frame block.");
+
+  // Shaders bind a block named Frame to this point when they are linked.
+  static const uint32_t FrameUniformBinding = 0;
+
+  // The Frame block's buffer. One instance is shared per context through Context::Shared.
+  class FrameUniformBuffer : public UniformBuffer {
+    public:
+    FrameUniformBuffer(const FrameUniformBuffer&) = default;
+    FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+
+    FrameUniformBuffer( );
+    ~FrameUniformBuffer( );
+
+    // The current context's frame block.
+    static std::shared_ptr<FrameUniformBuffer> Shared( );
+
+    void Update(const FrameUniforms& uniforms);
+  };
+
+}
\ No newline at end of file
@@ -133,17 +133,17 @@ SOFTWARE.
       // COMPARISON
 
       cclib_static_inline simd4f simd4f_cmp_eq(simd4f lhs, simd4f rhs) throw() {
-        const simd4f s = { { -(float) (lhs.f[0] == rhs.f[0]), -(float) (lhs.f[1] == rhs.f[1]), -(float) (lhs.f[2] == rhs.f[2]), -(float) (lhs.f[3] == rhs.f[3]) } };
+        const simd4f s = { { ((lhs.f[0] == rhs.f[0]) ? -1.0f : 0.0f), ((lhs.f[1] == rhs.f[1]) ? -1.0f : 0.0f), ((lhs.f[2] == rhs.f[2]) ? -1.0f : 0.0f), ((lhs.f[3] == rhs.f[3]) ? -1.0f : 0.0f) } };
         return s;
       }
 
       cclib_static_inline simd4f simd4f_cmp_gt(simd4f lhs, simd4f rhs) throw() {
-        const simd4f s = { { -(float) (lhs.f[0] > rhs.f[0]), -(float) (lhs.f[1] > rhs.f[1]), -(float) (lhs.f[2] > rhs.f[2]), -(float) (lhs.f[3] > rhs.f[3]) } };
+        const simd4f s = { { ((lhs.f[0] > rhs.f[0]) ? -1.0f : 0.0f), ((lhs.f[1] > rhs.f[1]) ? -1.0f : 0.0f), ((lhs.f[2] > rhs.f[2]) ? -1.0f : 0.0f), ((lhs.f[3] > rhs.f[3]) ? -1.0f : 0.0f) } };
         return s;
       }
 
       cclib_static_inline simd4f simd4f_cmp_lt(simd4f lhs, simd4f rhs) throw() {
-        const simd4f s = { { -(float) (lhs.f[0] < rhs.f[0]), -(float) (lhs.f[1] < rhs.f[1]), -(float) (lhs.f[2] < rhs.f[2]), -(float) (lhs.f[3] < rhs.f[3]) } };
+        const simd4f s = { { ((lhs.f[0] < rhs.f[0]) ? -1.0f : 0.0f), ((lhs.f[1] < rhs.f[1]) ? -1.0f : 0.0f), ((lhs.f[2] < rhs.f[2]) ? -1.0f : 0.0f), ((lhs.f[3] < rhs.f[3]) ? -1.0f : 0.0f) } };
         return s;
       }
 
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Maps a float onto an unsigned integer with the same ordering, so that floats can
+// be sorted as keys.
+inline uint32_t radix_float_key(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+// LSD radix sort of unsigned integer keys, one byte per pass. All histograms are
+// gathered in a single read of the keys, and passes in which every key shares the
+// same byte are skipped. Bytes below `firstByte` are treated as already ordered, which
+// allows a sequence number to ride along in the low bits of the key for free.
+template<typename T> void radix_sort(std::vector<T>& keys, std::vector<T>& scratch, uint32_t firstByte = 0) {
+  const size_t count = keys.size( );
+  if (count < 2) return;
+  scratch.resize(count);
+
+  size_t histograms[sizeof(T)][256];
+  memset(histograms, 0, sizeof(histograms));
+  for (size_t i = 0; i < count; ++i) {
+    const T key = keys[i];
+    for (uint32_t byte = firstByte; byte < sizeof(T); ++byte) {
+      histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+    }
+  }
+
+  for (uint32_t byte = firstByte; byte < sizeof(T); ++byte) {
+    const uint32_t shift = byte * 8;
+    auto offsets = histograms[byte];
+    if (offsets[(keys[0] >> shift) & 0xFF] == count) continue;
+
+    size_t total = 0;
+    for (uint32_t bucket = 0; bucket < 256; ++bucket) {
+      const auto bucketCount = offsets[bucket];
+      offsets[bucket] = total;
+      total += bucketCount;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      const T key = keys[i];
+      scratch[offsets[(key >> shift) & 0xFF]++] = key;
+    }
+    keys.swap(scratch);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "stdafx.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cclib/content/contentpack.h>
+#include <cclib/engineexception.h>
+
+using namespace std;
+using namespace std::tr2::sys;
+
+struct PackSource {
+  string Name;
+  string Path;
+  uint64_t Hash;
+  uint64_t Size;
+};
+
+static uint64_t Align(uint64_t offset) {
+  return (offset + content::PackAlignment - 1) & ~(uint64_t) (content::PackAlignment - 1);
+}
+
+// Builds a content pack from every file below a content folder. Entries are
+// named by their path relative to that folder, as ContentManager looks them up.
+int main(int argc, char* argv[ ]) {
+  if (argc != 3) {
+    cout << "usage: ccpack <content folder> <output pack>" << endl;
+    return 1;
+  }
+
+  try {
+    auto root = path(argv[1]);
+    auto rootName = root.string( );
+    auto output = path(argv[2]);
+
+    vector<PackSource> sources;
+    for (auto it = recursive_directory_iterator(root); it != recursive_directory_iterator( ); ++it) {
+      if (!is_regular_file(it->status( )) || (exists(output) && equivalent(it->path( ), output)))
+        continue;
+
+      auto fullName = it->path( ).string( );
+      auto name = content::ContentPack::Normalize(fullName.substr(rootName.size( )));
+      while (!name.empty( ) && name[0] == '/') name.erase(0, 1);
+
+      PackSource source = { name, fullName, content::ContentPack::Hash(name), (uint64_t) file_size(it->path( )) };
+      sources.push_back(source);
+    }
+
+    sort(sources.begin( ), sources.end( ), [ ](const PackSource& a, const PackSource& b) {
+      return a.Hash != b.Hash ? a.Hash < b.Hash : a.Name < b.Name;
+    });
+
+    content::PackHeader header;
+    copy(content::PackMagic, content::PackMagic + sizeof(content::PackMagic), header.Magic);
+    header.Version = content::PackVersion;
+    header.Count = (uint32_t) sources.size( );
+    header.Reserved = 0;
+
+    // Names follow the table; the data follows the names.
+    vector<content::PackEntry> entries(sources.size( ));
+    uint64_t nameOffset = sizeof(content::PackHeader) + entries.size( ) * sizeof(content::PackEntry);
+    for (size_t i = 0; i < sources.size( ); ++i) {
+      entries[i].Hash = sources[i].Hash;
+      entries[i].NameOffset = (uint32_t) nameOffset;
+      entries[i].NameSize = (uint32_t) sources[i].Name.size( );
+      nameOffset += sources[i].Name.size( );
+    }
+    uint64_t dataOffset = Align(nameOffset);
+    for (size_t i = 0; i < sources.size( ); ++i) {
+      entries[i].Offset = dataOffset;
+      entries[i].Size = sources[i].Size;
+      dataOffset = Align(dataOffset + sources[i].Size);
+    }
+
+    ofstream pack(output.string( ), ios::out | ios::binary | ios::trunc);
+    if (!pack.is_open( ))
+      throw EngineException("Unable to create pack: " + output.string( ), ErrorCode::CONTENT_INVALID_PATH);
+
+    pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!entries.empty( ))
+      pack.write(reinterpret_cast<const char*>(&entries[0]), entries.size( ) * sizeof(content::PackEntry));
+    for (auto it = sources.begin( ); it != sources.end( ); ++it) {
+      pack.write(it->Name.data( ), it->Name.size( ));
+    }
+
+    vector<char> buffer;
+    for (size_t i = 0; i < sources.size( ); ++i) {
+      auto padding = entries[i].Offset - (uint64_t) pack.tellp( );
+      buffer.assign((size_t) padding, 0);
+      if (padding) pack.write(&buffer[0], padding);
+
+      ifstream file(sources[i].Path, ios::in | ios::binary);
+      if (!file.is_open( ))
+        throw EngineException("Unable to read content file: " + sources[i].Path, ErrorCode::CONTENT_NOT_FOUND);
+      buffer.resize((size_t) sources[i].Size);
+      if (!buffer.empty( )) {
+        file.read(&buffer[0], buffer.size( ));
+        pack.write(&buffer[0], buffer.size( ));
+      }
+
+      cout << sources[i].Name << " (" << sources[i].Size << " bytes)" << endl;
+    }
+
+    if (!pack)
+      throw EngineException("Failed to write pack: " + output.string( ), ErrorCode::CONTENT_INVALID_PATH);
+
+    cout << sources.size( ) << " entries written to " << output.string( ) << endl;
+    return 0;
+  } catch (EngineException ee) {
+    cout << ee.what( ) << endl;
+    return (int) ee.code( );
+  }
+}
\ No newline at end of file